@@ -146,3 +146,9 @@ void WidgetTemplate::onDisowned(Widget& parent)
 {
 
 }
+
+
+void WidgetTemplate::onChildResize(Widget& child)
+{
+
+}
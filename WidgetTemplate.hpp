@@ -42,6 +42,7 @@ protected:
 	virtual void onDisown(Widget& child);
 	virtual void onAdopted(Widget& parent);
 	virtual void onDisowned(Widget& parent);
+	virtual void onChildResize(Widget& child);
 
 };
 
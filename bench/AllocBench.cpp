@@ -0,0 +1,180 @@
+/*********************************************************************
+ * Allocation benchmark for building widget trees.                   *
+ * Builds trees of small containers (a button with an icon and a     *
+ * label, a row of a few cells, ...) and counts heap allocations per *
+ * container, with widgets made by new and by Widget::create().      *
+ *                                                                   *
+ * Build: g++ -O2 -std=c++11 -Iinclude bench/AllocBench.cpp          *
+ *        (or build the AllocBench target with CMake)                *
+ *********************************************************************/
+
+#include <Widget.hpp>
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <new>
+#include <vector>
+
+
+static unsigned long long g_allocs = 0;
+static unsigned long long g_bytes = 0;
+
+// Every replaced operator new and delete goes through these, so the compiler never sees one of them paired with malloc/free.
+static void* allocate(std::size_t size)
+{
+	++g_allocs;
+	g_bytes += size;
+
+	void* mem = std::malloc(size ? size : 1);
+	if (!mem)
+		throw std::bad_alloc();
+
+	return mem;
+}
+
+static void deallocate(void* mem)
+{
+	std::free(mem);
+}
+
+void* operator new(std::size_t size)
+{
+	return allocate(size);
+}
+
+void operator delete(void* mem) noexcept
+{
+	deallocate(mem);
+}
+
+void operator delete(void* mem, std::size_t) noexcept
+{
+	deallocate(mem);
+}
+
+void* operator new[](std::size_t size)
+{
+	return operator new(size);
+}
+
+void operator delete[](void* mem) noexcept
+{
+	operator delete(mem);
+}
+
+void operator delete[](void* mem, std::size_t) noexcept
+{
+	operator delete(mem);
+}
+
+
+static const size_t NUM_CONTAINERS = 100000;
+
+enum Mode
+{
+	MODE_NEW,
+	MODE_CREATE
+};
+
+static const char* const MODE_NAMES[] = { "new", "create" };
+
+struct Result
+{
+	double allocsPerContainer;
+	double bytesPerContainer;
+	double nsPerWidget;
+};
+
+// Fill `root' with containers of `children' children each. Returns the number of widgets made.
+static size_t build(Widget& root, size_t children, Mode mode, std::vector<Widget*>& owned)
+{
+	size_t widgets = 0;
+
+	for (size_t i = 0; i < NUM_CONTAINERS; ++i)
+	{
+		Widget* container;
+
+		if (mode == MODE_CREATE)
+		{
+			container = root.create<Widget>();
+		}
+		else
+		{
+			container = new Widget();
+			root.addWidget(container);
+			owned.push_back(container);
+		}
+
+		container->setSize(64., 24.);
+		++widgets;
+
+		for (size_t c = 0; c < children; ++c)
+		{
+			Widget* child;
+
+			if (mode == MODE_CREATE)
+			{
+				child = container->create<Widget>();
+			}
+			else
+			{
+				child = new Widget();
+				container->addWidget(child);
+				owned.push_back(child);
+			}
+
+			child->setSize(16., 16.);
+			++widgets;
+		}
+	}
+
+	return widgets;
+}
+
+static Result run(size_t children, Mode mode)
+{
+	Result result;
+	std::vector<Widget*> owned;
+	owned.reserve(NUM_CONTAINERS * (children + 1));
+
+	Widget* root = new Widget();
+
+	unsigned long long allocs = g_allocs;
+	unsigned long long bytes = g_bytes;
+
+	std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+	size_t widgets = build(*root, children, mode, owned);
+	std::chrono::steady_clock::time_point end = std::chrono::steady_clock::now();
+
+	result.allocsPerContainer = static_cast<double>(g_allocs - allocs) / NUM_CONTAINERS;
+	result.bytesPerContainer = static_cast<double>(g_bytes - bytes) / NUM_CONTAINERS;
+	result.nsPerWidget = std::chrono::duration<double, std::nano>(end - start).count() / widgets;
+
+	// Children are deleted before their parents, so nobody is left with a dangling child.
+	delete root;
+
+	for (size_t i = owned.size(); i--;)
+		delete owned[i];
+
+	return result;
+}
+
+
+int main()
+{
+	std::printf("%10s %8s %18s %18s %14s\n", "children", "mode", "allocs/container", "bytes/container", "ns/widget");
+
+	for (size_t children = 0; children <= 6; ++children)
+	{
+		for (int mode = MODE_NEW; mode <= MODE_CREATE; ++mode)
+		{
+			Result result = run(children, static_cast<Mode>(mode));
+
+			std::printf("%10u %8s %18.2f %18.1f %14.1f\n", static_cast<unsigned int>(children), MODE_NAMES[mode],
+				result.allocsPerContainer, result.bytesPerContainer, result.nsPerWidget);
+		}
+	}
+
+	return 0;
+}
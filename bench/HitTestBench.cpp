@@ -0,0 +1,124 @@
+/*********************************************************************
+ * Hit-test benchmark for wide containers.                           *
+ * Compares plain child scans against packed bounds and the spatial  *
+ * index, using Widget::getChildAt().                                *
+ *                                                                   *
+ * Build: g++ -O2 -std=c++11 -Iinclude bench/HitTestBench.cpp        *
+ *        (add -mavx to use the AVX path instead of SSE2)            *
+ *********************************************************************/
+
+#include <Widget.hpp>
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+
+
+static const int NUM_QUERIES = 20000;
+
+enum Mode
+{
+	MODE_SCAN,
+	MODE_PACKED,
+	MODE_INDEX
+};
+
+
+// Build a container with `count' randomly placed children.
+static Widget* buildContainer(size_t count, Mode mode)
+{
+	Widget* root = new Widget();
+	root->setSize(4096., 4096.);
+
+	if (mode == MODE_PACKED)
+		root->setPackedBounds(true);
+	else if (mode == MODE_INDEX)
+		root->setSpatialIndex(true, 64.);
+
+	std::srand(1234);
+
+	for (size_t i = 0; i < count; ++i)
+	{
+		Widget* child = new Widget();
+		child->setPosition(std::rand() % 4000, std::rand() % 4000);
+		child->setSize(8 + std::rand() % 32, 8 + std::rand() % 32);
+		root->addWidget(child);
+	}
+
+	return root;
+}
+
+static void destroyContainer(Widget* root)
+{
+	while (root->hasChildren())
+	{
+		Widget* child = root->getChild(0);
+		root->removeWidget(child);
+		delete child;
+	}
+
+	delete root;
+}
+
+// Returns nanoseconds per query.
+static double run(size_t count, Mode mode, size_t& out_hits)
+{
+	Widget* root = buildContainer(count, mode);
+
+	std::srand(5678);
+
+	double* qx = new double[NUM_QUERIES];
+	double* qy = new double[NUM_QUERIES];
+
+	for (int i = 0; i < NUM_QUERIES; ++i)
+	{
+		qx[i] = std::rand() % 4096;
+		qy[i] = std::rand() % 4096;
+	}
+
+	out_hits = 0;
+
+	std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+
+	for (int i = 0; i < NUM_QUERIES; ++i)
+	{
+		if (root->getChildAt(qx[i], qy[i]))
+			++out_hits;
+	}
+
+	std::chrono::steady_clock::time_point end = std::chrono::steady_clock::now();
+
+	delete[] qx;
+	delete[] qy;
+	destroyContainer(root);
+
+	return std::chrono::duration<double, std::nano>(end - start).count() / NUM_QUERIES;
+}
+
+
+int main()
+{
+	static const size_t sizes[] = { 16, 256, 4096, 20000 };
+
+	std::printf("%10s %12s %12s %12s %10s %10s\n", "children", "scan ns", "packed ns", "index ns", "packed x", "index x");
+
+	for (size_t i = 0; i < sizeof(sizes) / sizeof(sizes[0]); ++i)
+	{
+		size_t hitsScan, hitsPacked, hitsIndex;
+
+		double scan = run(sizes[i], MODE_SCAN, hitsScan);
+		double packed = run(sizes[i], MODE_PACKED, hitsPacked);
+		double index = run(sizes[i], MODE_INDEX, hitsIndex);
+
+		if (hitsScan != hitsPacked || hitsScan != hitsIndex)
+		{
+			std::printf("Mismatching results for %u children.\n", static_cast<unsigned int>(sizes[i]));
+			return 1;
+		}
+
+		std::printf("%10u %12.1f %12.1f %12.1f %10.2f %10.2f\n", static_cast<unsigned int>(sizes[i]),
+			scan, packed, index, scan / packed, scan / index);
+	}
+
+	return 0;
+}
@@ -0,0 +1,250 @@
+/*********************************************************************
+ * Start-up benchmark for large screens.                             *
+ * Builds the same tree of panels, labels and buttons by hand (new,  *
+ * addWidget, setPosition, setSize), with create(), and by loading   *
+ * a memory-mapped widget file with WidgetLoader.                    *
+ *                                                                   *
+ * Build: g++ -O2 -std=c++11 -Iinclude bench/LoadBench.cpp           *
+ *        (or build the LoadBench target with CMake)                 *
+ * Usage: LoadBench [widget file to write, default LoadBench.wuit]   *
+ *********************************************************************/
+
+#include <Widget.hpp>
+#include <WidgetLoader.hpp>
+
+#include <chrono>
+#include <cstdio>
+#include <vector>
+
+
+typedef std::chrono::steady_clock Clock;
+
+static const int NUM_PANELS = 2000;
+static const int ITEMS_PER_PANEL = 24;
+static const int NUM_RUNS = 10;
+
+static unsigned long long g_events = 0;
+
+
+// A widget with the usual geometry and adoption event handlers.
+class SampleWidget : public Widget
+{
+protected:
+	virtual void onMove(double dx, double dy)
+	{
+		++g_events;
+	}
+
+	virtual void onResize()
+	{
+		++g_events;
+	}
+
+	virtual void onAdopt(Widget& child)
+	{
+		++g_events;
+	}
+
+	virtual void onAdopted(Widget& parent)
+	{
+		++g_events;
+	}
+};
+
+class PanelWidget : public SampleWidget
+{
+
+};
+
+class LabelWidget : public SampleWidget
+{
+
+};
+
+
+/* *** Building *** */
+
+// Position of an item within its panel.
+static void itemBounds(int i, double& x, double& y, double& w, double& h)
+{
+	x = 4. + (i % 4) * 40.;
+	y = 4. + (i / 4) * 20.;
+	w = 36.;
+	h = 16.;
+}
+
+static void panelBounds(int i, double& x, double& y, double& w, double& h)
+{
+	x = (i % 40) * 170.;
+	y = (i / 40) * 130.;
+	w = 168.;
+	h = 128.;
+}
+
+static void buildByHand(Widget& root, std::vector<Widget*>& owned)
+{
+	double x, y, w, h;
+
+	for (int p = 0; p < NUM_PANELS; ++p)
+	{
+		Widget* panel = new PanelWidget();
+		root.addWidget(panel);
+		panelBounds(p, x, y, w, h);
+		panel->setPosition(x, y);
+		panel->setSize(w, h);
+		owned.push_back(panel);
+
+		for (int i = 0; i < ITEMS_PER_PANEL; ++i)
+		{
+			Widget* item = new LabelWidget();
+			panel->addWidget(item);
+			itemBounds(i, x, y, w, h);
+			item->setPosition(x, y);
+			item->setSize(w, h);
+			owned.push_back(item);
+		}
+	}
+}
+
+static void buildWithCreate(Widget& root)
+{
+	double x, y, w, h;
+
+	for (int p = 0; p < NUM_PANELS; ++p)
+	{
+		Widget* panel = root.create<PanelWidget>();
+		panelBounds(p, x, y, w, h);
+		panel->setPosition(x, y);
+		panel->setSize(w, h);
+
+		for (int i = 0; i < ITEMS_PER_PANEL; ++i)
+		{
+			Widget* item = panel->create<LabelWidget>();
+			itemBounds(i, x, y, w, h);
+			item->setPosition(x, y);
+			item->setSize(w, h);
+		}
+	}
+}
+
+static bool writeFile(const char* path)
+{
+	WidgetFileWriter writer;
+	size_t panelType = writer.addType("panel");
+	size_t labelType = writer.addType("label");
+	double x, y, w, h;
+
+	for (int p = 0; p < NUM_PANELS; ++p)
+	{
+		panelBounds(p, x, y, w, h);
+		size_t panel = writer.addNode(panelType, WidgetFile::NO_PARENT, float(x), float(y), float(w), float(h));
+
+		for (int i = 0; i < ITEMS_PER_PANEL; ++i)
+		{
+			itemBounds(i, x, y, w, h);
+			writer.addNode(labelType, panel, float(x), float(y), float(w), float(h));
+		}
+	}
+
+	return writer.save(path);
+}
+
+
+/* *** Measuring *** */
+
+enum Method
+{
+	METHOD_HAND,
+	METHOD_CREATE,
+	METHOD_LOADER,
+
+	NUM_METHODS
+};
+
+static const char* const METHOD_NAMES[] = { "new + addWidget", "create()", "WidgetLoader" };
+
+// Returns milliseconds to build the tree into `root', not counting its destruction.
+// The root is kept between runs, so its pool is warm and the OS handing out fresh pages isn't measured.
+static double run(Widget& root, Method method, const char* path, const WidgetRegistry& registry)
+{
+	std::vector<Widget*> owned;
+
+	g_events = 0;
+
+	Clock::time_point start = Clock::now();
+
+	switch (method)
+	{
+	case METHOD_HAND:
+		buildByHand(root, owned);
+		break;
+
+	case METHOD_CREATE:
+		buildWithCreate(root);
+		break;
+
+	case METHOD_LOADER:
+	{
+		WidgetLoader loader(registry);
+
+		if (!loader.loadFile(root, path))
+			std::printf("Could not load `%s': %s\n", path, loader.getError());
+		break;
+	}
+
+	default:
+		break;
+	}
+
+	Clock::time_point end = Clock::now();
+
+	root.destroyChildren(false);
+
+	for (size_t i = owned.size(); i--;)
+	{
+		owned[i]->destroyChildren(false);
+		delete owned[i];
+	}
+
+	return std::chrono::duration<double, std::milli>(end - start).count();
+}
+
+
+int main(int argc, char** argv)
+{
+	const char* path = (argc > 1) ? argv[1] : "LoadBench.wuit";
+
+	if (!writeFile(path))
+	{
+		std::printf("Could not write `%s'.\n", path);
+		return 1;
+	}
+
+	WidgetRegistry registry;
+	registry.registerType<PanelWidget>("panel");
+	registry.registerType<LabelWidget>("label");
+
+	std::printf("%d widgets\n", NUM_PANELS * (ITEMS_PER_PANEL + 1));
+	std::printf("%-16s %12s %12s\n", "method", "best ms", "events");
+
+	for (int m = 0; m < NUM_METHODS; ++m)
+	{
+		Widget root;
+		root.setSize(6800., 6500.);
+		root.setDamageTracking(true);
+
+		double best = 0.;
+
+		for (int r = 0; r < NUM_RUNS; ++r)
+		{
+			double ms = run(root, static_cast<Method>(m), path, registry);
+
+			if (r == 0 || ms < best)
+				best = ms;
+		}
+
+		std::printf("%-16s %12.2f %12llu\n", METHOD_NAMES[m], best, g_events);
+	}
+
+	return 0;
+}
@@ -0,0 +1,309 @@
+/*********************************************************************
+ * Instancing benchmark for dashboards.                              *
+ * Builds the same grid of cards (frame, icon, two labels and a row  *
+ * of two buttons) by hand (new, addWidget, setPosition, setSize),   *
+ * with create(), and by instantiating a WidgetPrototype with a      *
+ * per-card override.                                                *
+ *                                                                   *
+ * Build: g++ -O2 -std=c++11 -Iinclude bench/PrototypeBench.cpp      *
+ *        (or build the PrototypeBench target with CMake)            *
+ *********************************************************************/
+
+#include <Widget.hpp>
+#include <WidgetPrototype.hpp>
+
+#include <chrono>
+#include <cstdio>
+#include <vector>
+
+
+typedef std::chrono::steady_clock Clock;
+
+static const int NUM_CARDS = 5000;
+static const int WIDGETS_PER_CARD = 7;
+static const int NUM_RUNS = 10;
+
+static unsigned long long g_events = 0;
+
+
+// A widget with the usual geometry and adoption event handlers.
+class SampleWidget : public Widget
+{
+protected:
+	virtual void onMove(double dx, double dy)
+	{
+		++g_events;
+	}
+
+	virtual void onResize()
+	{
+		++g_events;
+	}
+
+	virtual void onAdopt(Widget& child)
+	{
+		++g_events;
+	}
+
+	virtual void onAdopted(Widget& parent)
+	{
+		++g_events;
+	}
+};
+
+class FrameWidget : public SampleWidget
+{
+
+};
+
+class IconWidget : public SampleWidget
+{
+public:
+	IconWidget()
+		: icon(0)
+	{
+
+	}
+
+	int icon;
+};
+
+class LabelWidget : public SampleWidget
+{
+public:
+	LabelWidget()
+		: value(0)
+	{
+
+	}
+
+	int value;
+};
+
+class ButtonWidget : public SampleWidget
+{
+
+};
+
+// Nodes of the card prototype.
+enum CardNode
+{
+	CARD_FRAME,
+	CARD_ICON,
+	CARD_TITLE,
+	CARD_VALUE,
+	CARD_BUTTONS,
+	CARD_OPEN,
+	CARD_CLOSE
+};
+
+
+/* *** Building *** */
+
+static void cardPosition(int i, double& x, double& y)
+{
+	x = (i % 50) * 130.;
+	y = (i / 50) * 90.;
+}
+
+static void buildByHand(Widget& root, std::vector<Widget*>& owned)
+{
+	double x, y;
+
+	for (int c = 0; c < NUM_CARDS; ++c)
+	{
+		Widget* frame = new FrameWidget();
+		root.addWidget(frame);
+		cardPosition(c, x, y);
+		frame->setPosition(x, y);
+		frame->setSize(128., 88.);
+		owned.push_back(frame);
+
+		IconWidget* icon = new IconWidget();
+		frame->addWidget(icon);
+		icon->setPosition(4., 4.);
+		icon->setSize(24., 24.);
+		icon->icon = c % 16;
+		owned.push_back(icon);
+
+		Widget* title = new LabelWidget();
+		frame->addWidget(title);
+		title->setPosition(32., 4.);
+		title->setSize(92., 16.);
+		owned.push_back(title);
+
+		LabelWidget* value = new LabelWidget();
+		frame->addWidget(value);
+		value->setPosition(32., 24.);
+		value->setSize(92., 16.);
+		value->value = c;
+		owned.push_back(value);
+
+		Widget* buttons = new Widget();
+		frame->addWidget(buttons);
+		buttons->setPosition(4., 60.);
+		buttons->setSize(120., 24.);
+		owned.push_back(buttons);
+
+		Widget* open = new ButtonWidget();
+		buttons->addWidget(open);
+		open->setSize(58., 24.);
+		owned.push_back(open);
+
+		Widget* close = new ButtonWidget();
+		buttons->addWidget(close);
+		close->setPosition(62., 0.);
+		close->setSize(58., 24.);
+		owned.push_back(close);
+	}
+}
+
+static void buildWithCreate(Widget& root)
+{
+	double x, y;
+
+	for (int c = 0; c < NUM_CARDS; ++c)
+	{
+		Widget* frame = root.create<FrameWidget>();
+		cardPosition(c, x, y);
+		frame->setPosition(x, y);
+		frame->setSize(128., 88.);
+
+		IconWidget* icon = frame->create<IconWidget>();
+		icon->setPosition(4., 4.);
+		icon->setSize(24., 24.);
+		icon->icon = c % 16;
+
+		Widget* title = frame->create<LabelWidget>();
+		title->setPosition(32., 4.);
+		title->setSize(92., 16.);
+
+		LabelWidget* value = frame->create<LabelWidget>();
+		value->setPosition(32., 24.);
+		value->setSize(92., 16.);
+		value->value = c;
+
+		Widget* buttons = frame->create<Widget>();
+		buttons->setPosition(4., 60.);
+		buttons->setSize(120., 24.);
+
+		Widget* open = buttons->create<ButtonWidget>();
+		open->setSize(58., 24.);
+
+		Widget* close = buttons->create<ButtonWidget>();
+		close->setPosition(62., 0.);
+		close->setSize(58., 24.);
+	}
+}
+
+static void recordCard(WidgetPrototype& card)
+{
+	size_t frame = card.add<FrameWidget>();
+	card.setBounds(frame, 0., 0., 128., 88.);
+	card.setBounds(card.add<IconWidget>(frame), 4., 4., 24., 24.);
+	card.setBounds(card.add<LabelWidget>(frame), 32., 4., 92., 16.);
+	card.setBounds(card.add<LabelWidget>(frame), 32., 24., 92., 16.);
+
+	size_t buttons = card.add<Widget>(frame);
+	card.setBounds(buttons, 4., 60., 120., 24.);
+	card.setBounds(card.add<ButtonWidget>(buttons), 0., 0., 58., 24.);
+	card.setBounds(card.add<ButtonWidget>(buttons), 62., 0., 58., 24.);
+}
+
+// The fields that differ from card to card.
+static void overrideCard(WidgetPrototype::Instance& card, void* udata)
+{
+	int c = static_cast<int>(card.getIndex());
+	double x, y;
+
+	cardPosition(c, x, y);
+	card.setPosition(CARD_FRAME, x, y);
+	card.get<IconWidget>(CARD_ICON)->icon = c % 16;
+	card.get<LabelWidget>(CARD_VALUE)->value = c;
+}
+
+
+/* *** Measuring *** */
+
+enum Method
+{
+	METHOD_HAND,
+	METHOD_CREATE,
+	METHOD_PROTOTYPE,
+
+	NUM_METHODS
+};
+
+static const char* const METHOD_NAMES[] = { "new + addWidget", "create()", "WidgetPrototype" };
+
+// Returns milliseconds to build the cards into `root', not counting their destruction.
+// The root is kept between runs, so its pool is warm and the OS handing out fresh pages isn't measured.
+static double run(Widget& root, Method method, WidgetPrototype& card)
+{
+	std::vector<Widget*> owned;
+
+	g_events = 0;
+
+	Clock::time_point start = Clock::now();
+
+	switch (method)
+	{
+	case METHOD_HAND:
+		buildByHand(root, owned);
+		break;
+
+	case METHOD_CREATE:
+		buildWithCreate(root);
+		break;
+
+	case METHOD_PROTOTYPE:
+		card.instantiate(root, NUM_CARDS, &overrideCard);
+		break;
+
+	default:
+		break;
+	}
+
+	Clock::time_point end = Clock::now();
+
+	root.destroyChildren(false);
+
+	for (size_t i = owned.size(); i--;)
+	{
+		owned[i]->destroyChildren(false);
+		delete owned[i];
+	}
+
+	return std::chrono::duration<double, std::milli>(end - start).count();
+}
+
+
+int main()
+{
+	WidgetPrototype card;
+	recordCard(card);
+
+	std::printf("%d widgets\n", NUM_CARDS * WIDGETS_PER_CARD);
+	std::printf("%-16s %12s %12s\n", "method", "best ms", "events");
+
+	for (int m = 0; m < NUM_METHODS; ++m)
+	{
+		Widget root;
+		root.setSize(6500., 9000.);
+		root.setDamageTracking(true);
+
+		double best = 0.;
+
+		for (int r = 0; r < NUM_RUNS; ++r)
+		{
+			double ms = run(root, static_cast<Method>(m), card);
+
+			if (r == 0 || ms < best)
+				best = ms;
+		}
+
+		std::printf("%-16s %12.2f %12llu\n", METHOD_NAMES[m], best, g_events);
+	}
+
+	return 0;
+}
@@ -0,0 +1,186 @@
+/*********************************************************************
+ * Input replay benchmark.                                           *
+ * Replays a recorded input log into a sample tree as fast as        *
+ * possible and prints the latency percentiles of every kind of      *
+ * record, and the total throughput.                                 *
+ * Without a log, a synthetic session is recorded first.             *
+ *                                                                   *
+ * Build: g++ -O2 -std=c++11 -Iinclude bench/ReplayBench.cpp         *
+ *        (or build the ReplayBench target with CMake)               *
+ * Usage: ReplayBench [log to replay] [file to save the log to]      *
+ *********************************************************************/
+
+#include <Widget.hpp>
+#include <WidgetInputRecorder.hpp>
+
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+
+
+static const double ROOT_SIZE = 1024.;
+static const int NUM_FRAMES = 5000;
+
+
+// A widget doing a little work on every event it gets.
+class SampleWidget : public Widget
+{
+public:
+	SampleWidget()
+		: m_work(0)
+	{
+
+	}
+
+protected:
+	virtual void onUpdate(double dt)
+	{
+		m_work += static_cast<unsigned long>(dt * 1000.);
+		Widget::onUpdate(dt);
+	}
+
+	virtual void onPress(double x, double y, unsigned int b)
+	{
+		++m_work;
+	}
+
+	virtual void onMouseEnter()
+	{
+		++m_work;
+	}
+
+	virtual void onKeyDown(int key)
+	{
+		m_work += key;
+		Widget::onKeyDown(key);
+	}
+
+private:
+	unsigned long m_work;
+};
+
+
+// Fill `parent' with a square grid of `count' children, recursing `levels' times.
+static void buildGrid(Widget& parent, size_t count, int levels)
+{
+	size_t side = 1;
+	while (side * side < count)
+		++side;
+
+	double cellW = parent.getWidth() / side;
+	double cellH = parent.getHeight() / side;
+
+	for (size_t i = 0; i < count; ++i)
+	{
+		Widget* child = parent.create<SampleWidget>();
+		child->setPosition((i % side) * cellW, (i / side) * cellH);
+		child->setSize(cellW, cellH);
+
+		if (levels > 1)
+			buildGrid(*child, count, levels - 1);
+	}
+}
+
+static void buildTree(Widget& root)
+{
+	root.setSize(ROOT_SIZE, ROOT_SIZE);
+	buildGrid(root, 16, 3);
+}
+
+// Drive the tree with a synthetic session: a wandering mouse with clicks, scrolling and typing, at 60 frames per second.
+static void runSession(Widget& root)
+{
+	double x = ROOT_SIZE / 2., y = ROOT_SIZE / 2.;
+	double time = 0.;
+
+	std::srand(1234);
+
+	for (int frame = 0; frame < NUM_FRAMES; ++frame)
+	{
+		for (int i = std::rand() % 4; i > 0; --i)
+		{
+			double dx = std::rand() % 17 - 8;
+			double dy = std::rand() % 17 - 8;
+
+			x = std::min(std::max(x + dx, 0.), ROOT_SIZE - 1.);
+			y = std::min(std::max(y + dy, 0.), ROOT_SIZE - 1.);
+
+			root.queueMouseMove(x, y, dx, dy, time);
+		}
+
+		if (frame % 45 == 0)
+		{
+			root.queueMouseDown(x, y, 1, time);
+			root.queueMouseUp(x, y, 1, time);
+		}
+
+		if (frame % 30 == 0)
+			root.queueMouseWheel(x, y, (frame / 30) % 2 ? 1 : -1, time);
+
+		if (frame % 10 == 0)
+		{
+			int key = 'a' + frame % 26;
+			root.keyDown(key);
+			root.keyText(static_cast<unsigned int>(key));
+			root.keyUp(key);
+		}
+
+		root.update(1. / 60.);
+		time += 1. / 60.;
+	}
+}
+
+
+int main(int argc, char** argv)
+{
+	InputLog log;
+
+	if (argc > 1 && std::strcmp(argv[1], "-") != 0)
+	{
+		if (!log.load(argv[1]))
+		{
+			std::printf("Could not read the input log `%s'.\n", argv[1]);
+			return 1;
+		}
+	}
+	else
+	{
+		Widget root;
+		buildTree(root);
+
+		InputRecorder recorder;
+		recorder.start(root);
+		runSession(root);
+		recorder.stop();
+
+		log = recorder.getLog();
+	}
+
+	std::printf("%u records, %u bytes\n", static_cast<unsigned int>(log.getNumOfRecords()), static_cast<unsigned int>(log.getSize()));
+
+	if (argc > 2 && !log.save(argv[2]))
+	{
+		std::printf("Could not write the input log `%s'.\n", argv[2]);
+		return 1;
+	}
+
+	// Warm up on one tree, then measure on a fresh one, so both start from the same state as the recording.
+	InputReplayer replayer;
+
+	{
+		Widget root;
+		buildTree(root);
+		replayer.replay(root, log);
+	}
+
+	Widget root;
+	buildTree(root);
+
+	if (!replayer.replay(root, log))
+		std::printf("The input log is malformed, only part of it was replayed.\n");
+
+	replayer.print();
+
+	return 0;
+}
@@ -0,0 +1,300 @@
+/*********************************************************************
+ * Traversal benchmark for synthetic widget trees.                   *
+ * Measures event dispatch, update and draw over deep chains, wide   *
+ * fan-outs, balanced trees and trees with hidden subtrees, in both  *
+ * broadcast and culled dispatch modes.                              *
+ *                                                                   *
+ * Prints one JSON object per line:                                  *
+ *   {"tree": ..., "nodes": ..., "dispatch": ..., "op": ...,         *
+ *    "iterations": ..., "ns_per_op": ..., "visits_per_op": ...}     *
+ * `visits_per_op' counts event handlers called per operation.       *
+ *                                                                   *
+ * Build: g++ -O2 -std=c++11 -Iinclude bench/WidgetBench.cpp         *
+ *        (or build the WidgetBench target with CMake)               *
+ * Usage: WidgetBench [seconds per measurement, default 0.2]         *
+ *********************************************************************/
+
+#include <Widget.hpp>
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <vector>
+
+
+typedef std::chrono::steady_clock Clock;
+
+static unsigned long long g_visits = 0;
+static double g_seconds = 0.2;
+
+static const int NUM_POSITIONS = 4096;
+static const double ROOT_SIZE = 4096.;
+
+
+// A widget counting every event handler call.
+class CountingWidget : public Widget
+{
+protected:
+	virtual void onUpdate(double dt)
+	{
+		++g_visits;
+		Widget::onUpdate(dt);
+	}
+
+	virtual void onDraw(double scrx, double scry, void* udata = NULL)
+	{
+		++g_visits;
+		Widget::onDraw(scrx, scry, udata);
+	}
+
+	virtual void onMouseDown(double x, double y, unsigned int b)
+	{
+		++g_visits;
+		Widget::onMouseDown(x, y, b);
+	}
+
+	virtual void onMouseUp(double x, double y, unsigned int b)
+	{
+		++g_visits;
+		Widget::onMouseUp(x, y, b);
+	}
+
+	virtual void onMouseMove(double x, double y, double dx, double dy)
+	{
+		++g_visits;
+		Widget::onMouseMove(x, y, dx, dy);
+	}
+
+	virtual void onKeyDown(int key)
+	{
+		++g_visits;
+		Widget::onKeyDown(key);
+	}
+};
+
+
+/* *** Trees *** */
+
+// A chain of `depth' widgets, each one filling its parent.
+static size_t buildChain(Widget& root, size_t depth)
+{
+	Widget* cur = &root;
+
+	for (size_t i = 0; i < depth; ++i)
+	{
+		cur = cur->create<CountingWidget>();
+		cur->setSize(ROOT_SIZE, ROOT_SIZE);
+	}
+
+	return depth;
+}
+
+// Fill `parent' with a square grid of `count' children, recursing `levels' times.
+// Every `hiddenEvery'-th child is hidden (never, if 0).
+static size_t buildGrid(Widget& parent, size_t count, int levels, size_t hiddenEvery)
+{
+	size_t side = 1;
+	while (side * side < count)
+		++side;
+
+	double cellW = parent.getWidth() / side;
+	double cellH = parent.getHeight() / side;
+	size_t nodes = 0;
+
+	for (size_t i = 0; i < count; ++i)
+	{
+		Widget* child = parent.create<CountingWidget>();
+		child->setPosition((i % side) * cellW, (i / side) * cellH);
+		child->setSize(cellW, cellH);
+
+		if (hiddenEvery && i % hiddenEvery == hiddenEvery - 1)
+			child->hide(true);
+
+		++nodes;
+
+		if (levels > 1)
+			nodes += buildGrid(*child, count, levels - 1, hiddenEvery);
+	}
+
+	return nodes;
+}
+
+enum TreeKind
+{
+	TREE_CHAIN,
+	TREE_WIDE,
+	TREE_BALANCED,
+	TREE_HIDDEN
+};
+
+static const char* const TREE_NAMES[] = { "chain", "wide", "balanced", "hidden" };
+
+static size_t buildTree(Widget& root, TreeKind kind)
+{
+	root.setSize(ROOT_SIZE, ROOT_SIZE);
+
+	switch (kind)
+	{
+	case TREE_CHAIN:    return buildChain(root, 1000);
+	case TREE_WIDE:     return buildGrid(root, 100000, 1, 0);
+	case TREE_BALANCED: return buildGrid(root, 10, 5, 0);
+	case TREE_HIDDEN:   return buildGrid(root, 10, 5, 3);
+	}
+
+	return 0;
+}
+
+
+/* *** Measuring *** */
+
+enum Op
+{
+	OP_MOUSE_DOWN,
+	OP_MOUSE_UP,
+	OP_MOUSE_MOVE,
+	OP_KEY_DOWN,
+	OP_UPDATE,
+	OP_DRAW,
+
+	NUM_OPS
+};
+
+static const char* const OP_NAMES[] = { "mouseDown", "mouseUp", "mouseMove", "keyDown", "update", "draw" };
+
+struct Result
+{
+	unsigned long long iterations;
+	double nsPerOp;
+	double visitsPerOp;
+};
+
+static double g_posX[NUM_POSITIONS];
+static double g_posY[NUM_POSITIONS];
+
+// Run an operation over and over until the time budget is spent.
+// Mouse downs and ups are timed one at a time, since each down needs a matching up.
+static Result measure(Widget& root, Op op)
+{
+	Result result;
+	unsigned long long n = 0;
+	Clock::duration spent = Clock::duration::zero();
+	double lastX = 0., lastY = 0.;
+
+	g_visits = 0;
+
+	Clock::time_point start = Clock::now();
+	Clock::time_point end = start + std::chrono::duration_cast<Clock::duration>(std::chrono::duration<double>(g_seconds));
+
+	do
+	{
+		for (int k = 0; k < 16; ++k, ++n)
+		{
+			double x = g_posX[n % NUM_POSITIONS];
+			double y = g_posY[n % NUM_POSITIONS];
+
+			switch (op)
+			{
+			case OP_MOUSE_DOWN:
+			case OP_MOUSE_UP:
+			{
+				unsigned long long before = g_visits;
+				Clock::time_point t0 = Clock::now();
+				root.mouseDown(x, y, 1);
+				Clock::time_point t1 = Clock::now();
+				unsigned long long downVisits = g_visits - before;
+				root.mouseUp(x, y, 1);
+				Clock::time_point t2 = Clock::now();
+
+				// Only keep the half being measured.
+				if (op == OP_MOUSE_DOWN)
+				{
+					spent += t1 - t0;
+					g_visits = before + downVisits;
+				}
+				else
+				{
+					spent += t2 - t1;
+					g_visits -= downVisits;
+				}
+				break;
+			}
+
+			case OP_MOUSE_MOVE:
+				root.mouseMove(x, y, x - lastX, y - lastY);
+				lastX = x;
+				lastY = y;
+				break;
+
+			case OP_KEY_DOWN:
+				root.keyDown(static_cast<int>(n & 0xff));
+				break;
+
+			case OP_UPDATE:
+				root.update(1. / 60.);
+				break;
+
+			case OP_DRAW:
+				root.draw();
+				break;
+
+			default:
+				break;
+			}
+		}
+	}
+	while (Clock::now() < end);
+
+	if (op != OP_MOUSE_DOWN && op != OP_MOUSE_UP)
+		spent = Clock::now() - start;
+
+	result.iterations = n;
+	result.nsPerOp = std::chrono::duration<double, std::nano>(spent).count() / n;
+	result.visitsPerOp = static_cast<double>(g_visits) / n;
+
+	return result;
+}
+
+
+int main(int argc, char** argv)
+{
+	if (argc > 1)
+		g_seconds = std::atof(argv[1]);
+
+	std::srand(1234);
+
+	for (int i = 0; i < NUM_POSITIONS; ++i)
+	{
+		g_posX[i] = std::rand() % static_cast<int>(ROOT_SIZE);
+		g_posY[i] = std::rand() % static_cast<int>(ROOT_SIZE);
+	}
+
+	static const unsigned int dispatchModes[] = {
+		Widget::DISPATCH_BROADCAST,
+		Widget::DISPATCH_FOCUSED_KEYS | Widget::DISPATCH_CULLED_MOUSE_MOVE | Widget::DISPATCH_CAPTURED_MOUSE_UP |
+			Widget::DISPATCH_CULLED_MOUSE_DOWN
+	};
+	static const char* const dispatchNames[] = { "broadcast", "culled" };
+
+	for (int kind = TREE_CHAIN; kind <= TREE_HIDDEN; ++kind)
+	{
+		for (int mode = 0; mode < 2; ++mode)
+		{
+			Widget root;
+			size_t nodes = buildTree(root, static_cast<TreeKind>(kind)) + 1;
+			root.setDispatchFlags(dispatchModes[mode]);
+
+			for (int op = 0; op < NUM_OPS; ++op)
+			{
+				Result result = measure(root, static_cast<Op>(op));
+
+				std::printf("{\"tree\": \"%s\", \"nodes\": %u, \"dispatch\": \"%s\", \"op\": \"%s\", "
+					"\"iterations\": %llu, \"ns_per_op\": %.1f, \"visits_per_op\": %.1f}\n",
+					TREE_NAMES[kind], static_cast<unsigned int>(nodes), dispatchNames[mode], OP_NAMES[op],
+					result.iterations, result.nsPerOp, result.visitsPerOp);
+				std::fflush(stdout);
+			}
+		}
+	}
+
+	return 0;
+}
@@ -33,863 +33,4801 @@
 #ifndef _WIDGET_HPP_INCLUDED
 #define _WIDGET_HPP_INCLUDED
 
+#include <cstddef>
+#include <cmath>
+#include <climits>
+#include <algorithm>
+#include <atomic>
+#include <new>
+#include <utility>
 #include <vector>
+#include <unordered_map>
 
+// SIMD is used for hit-testing packed child bounds of float and double widgets. Define WIDGET_NO_SIMD to disable it.
+#if !defined(WIDGET_NO_SIMD)
+	#if defined(__AVX__)
+		#define WIDGET_SIMD_AVX
+		#include <immintrin.h>
+	#elif defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+		#define WIDGET_SIMD_SSE2
+		#include <emmintrin.h>
+	#endif
+#endif
 
-class Widget
+// Dispatch statistics (see Widget::getStats) are only compiled in when WIDGET_ENABLE_STATS is defined.
+#if defined(WIDGET_ENABLE_STATS)
+	#include <chrono>
+	#include <typeindex>
+	#include <typeinfo>
+	#define WIDGET_STATS_EVENT(event) EventStatsScope widgetStatsEvent_(this, Stats::event)
+	#define WIDGET_STATS_VISIT(event) do { if (Stats* widgetStats_ = activeStats()) ++widgetStats_->visits[Stats::event]; } while (0)
+	#define WIDGET_STATS_TIME(widget, event) TimeStatsScope widgetStatsTime_(widget, Stats::event)
+#else
+	#define WIDGET_STATS_EVENT(event)
+	#define WIDGET_STATS_VISIT(event)
+	#define WIDGET_STATS_TIME(widget, event)
+#endif
+
+#include "WidgetDisplayList.hpp"
+#include "WidgetPool.hpp"
+
+
+// Runs a batch of independent tasks, possibly on other threads. Used for parallel updates, see Widget::setUpdateExecutor().
+// WidgetThreadPool.hpp has a work-stealing implementation.
+class UpdateExecutor
+{
+public:
+	virtual ~UpdateExecutor()
+	{
+		
+	}
+	
+	// Call task(ctx, i) for every i in [0, count), and return once all of them are done.
+	virtual void run(size_t count, void (*task)(void* ctx, size_t i), void* ctx) = 0;
+};
+
+
+// The widget base class, templated over the type used for positions and sizes.
+// Use Widget for double-precision coordinates, or e.g. BasicWidget<float> for a more compact tree.
+template <typename T>
+class BasicWidget
 {
+public:
+	
+	// An axis-aligned rectangle.
+	struct Rect
+	{
+		T x, y, width, height;
+		
+		Rect()
+			: x(T(0)), y(T(0)), width(T(0)), height(T(0))
+		{
+			
+		}
+		
+		Rect(T rx, T ry, T rwidth, T rheight)
+			: x(rx), y(ry), width(rwidth), height(rheight)
+		{
+			
+		}
+		
+		bool isEmpty() const
+		{
+			return !(width > T(0) && height > T(0));
+		}
+		
+		// Do the two rectangles overlap? Rectangles only sharing an edge do not.
+		bool intersects(const Rect& other) const
+		{
+			return other.x < x + width && x < other.x + other.width &&
+			       other.y < y + height && y < other.y + other.height;
+		}
+		
+		// Do the two rectangles overlap or share an edge?
+		bool touches(const Rect& other) const
+		{
+			return other.x <= x + width && x <= other.x + other.width &&
+			       other.y <= y + height && y <= other.y + other.height;
+		}
+		
+		// Grow this rectangle to also cover `other'.
+		void merge(const Rect& other)
+		{
+			T x1 = (x + width > other.x + other.width) ? x + width : other.x + other.width;
+			T y1 = (y + height > other.y + other.height) ? y + height : other.y + other.height;
+			
+			if (other.x < x) x = other.x;
+			if (other.y < y) y = other.y;
+			
+			width = x1 - x;
+			height = y1 - y;
+		}
+		
+		// Grow this rectangle to also cover `other', ignoring empty rectangles.
+		void add(const Rect& other)
+		{
+			if (isEmpty())
+				*this = other;
+			else if (!other.isEmpty())
+				this->merge(other);
+		}
+		
+		// Shrink this rectangle to the area it shares with `other'. It becomes empty if they don't overlap.
+		void clip(const Rect& other)
+		{
+			T x1 = (x + width < other.x + other.width) ? x + width : other.x + other.width;
+			T y1 = (y + height < other.y + other.height) ? y + height : other.y + other.height;
+			
+			if (other.x > x) x = other.x;
+			if (other.y > y) y = other.y;
+			
+			width = (x1 > x) ? x1 - x : T(0);
+			height = (y1 > y) ? y1 - y : T(0);
+		}
+	};
+	
+	// When drawing a tree with damage tracking enabled, or recording it into a display list, onDraw receives a pointer to this as `udata'.
+	// The pointer originally given to draw()/record() is kept in `udata'.
+	struct DrawContext
+	{
+		void* udata;
+		
+		// Set while recording. Widgets should record their draw commands into it instead of drawing directly.
+		DisplayList* list;
+		
+		// Merged damage rectangles, in screen coordinates. Only these areas need to be presented.
+		const Rect* damage;
+		size_t numDamage;
+		
+		// Everything must be redrawn. The damage list is empty when this is set.
+		bool fullRedraw;
+		
+		// Area (in screen coordinates) the widget being drawn is clipped to, when `clipped' is set.
+		// See setViewport() and setClipChildren(). Backends can use it as a scissor rectangle.
+		Rect clip;
+		bool clipped;
+	};
+	
+#if defined(WIDGET_ENABLE_STATS)
+	
+	// Dispatch statistics of a tree, collected when WIDGET_ENABLE_STATS is defined. See getStats().
+	struct Stats
+	{
+		enum Event
+		{
+			EVENT_UPDATE,
+			EVENT_DRAW,
+			EVENT_MOUSE_DOWN,
+			EVENT_MOUSE_UP,
+			EVENT_MOUSE_WHEEL,
+			EVENT_MOUSE_MOVE,
+			EVENT_KEY_DOWN,
+			EVENT_KEY_UP,
+			EVENT_KEY_TEXT,
+			
+			NUM_EVENTS
+		};
+		
+		// Cost of one concrete widget type. Times are in seconds, and don't include the widget's children.
+		struct TypeCost
+		{
+			const char* name;     /* From std::type_info::name(), so possibly mangled. */
+			unsigned long long updates, draws;
+			double updateTime, drawTime;
+			
+			TypeCost()
+				: name(NULL), updates(0), draws(0), updateTime(0.), drawTime(0.)
+			{
+				
+			}
+		};
+		
+		typedef std::unordered_map<std::type_index, TypeCost> TypeCostMap;
+		
+		unsigned long long calls[NUM_EVENTS];  /* Events sent into the tree (update(), mouseDown(), ...) */
+		unsigned long long visits[NUM_EVENTS]; /* Event handlers reached by them, counted as the base class handlers run. */
+		TypeCostMap types;
+		
+		Stats()
+		{
+			this->reset();
+		}
+		
+		void reset()
+		{
+			for (int i = 0; i < NUM_EVENTS; ++i)
+				calls[i] = visits[i] = 0;
+			
+			types.clear();
+		}
+		
+		static const char* getEventName(Event event)
+		{
+			static const char* const names[NUM_EVENTS] = {
+				"update", "draw", "mouseDown", "mouseUp", "mouseWheel", "mouseMove", "keyDown", "keyUp", "keyText"
+			};
+			
+			return names[event];
+		}
+	};
+	
+#endif
+	
+	// A raw input event, queued on the root widget and dispatched once per frame. (See queueMouseMove, processInput.)
+	struct InputEvent
+	{
+		enum Type
+		{
+			MOUSE_DOWN,
+			MOUSE_UP,
+			MOUSE_WHEEL,
+			MOUSE_MOVE,
+			KEY_DOWN,
+			KEY_UP,
+			KEY_TEXT
+		};
+		
+		Type type;
+		double time;              /* Timestamp given by the host. For merged events, the time of the last one. */
+		
+		T x, y;                   /* Mouse position. */
+		T dx, dy;                 /* Mouse move distance. */
+		int value;                /* Wheel delta, or key. */
+		unsigned int button;      /* Mouse button, or text character. */
+		
+		// The raw events this event was merged from, as a range of getInputHistory().
+		size_t first, count;
+	};
+	
+	// Receives the input given to a root widget, before it is dispatched. See setInputListener().
+	class InputListener
+	{
+	public:
+		virtual ~InputListener()
+		{
+			
+		}
+		
+		// Input given to the root. `queued' is true for events given with queueMouseDown() etc., which are reported when they
+		// are queued, not again when processInput() dispatches them.
+		virtual void onInput(const InputEvent& event, bool queued) = 0;
+		
+		// The root is being updated, before its queued input is processed.
+		virtual void onUpdate(double dt) = 0;
+	};
+	
+	// Builds many owned widgets, then attaches them all to a parent in one go. Used by WidgetLoader.hpp and WidgetPrototype.hpp.
+	// Widgets are constructed in the memory pool of the parent's tree, like create() does, and are linked to their parent as they
+	// are added, while both are still in cache, without any events. The top-level widgets are attached to the parent in bulk by
+	// finish(). Only then are the events that were held back sent, parents before children: Adopt/Adopted, then Move and Resize.
+	// Widgets still unattached when the builder is destroyed are destroyed with it.
+	class BulkBuilder
+	{
+	public:
+		
+		static const size_t NO_PARENT = ~static_cast<size_t>(0);
+		
+		// Constructs a widget in a block of memory. See constructWidget().
+		typedef BasicWidget* (*Constructor)(void* memory);
+		
+		BulkBuilder(BasicWidget& parent)
+			: m_parent(parent), m_pool(NULL)
+		{
+			
+		}
+		
+		~BulkBuilder()
+		{
+			// Destroying a top-level widget takes its children with it.
+			for (size_t i = m_top.size(); i--;)
+				freeOwned(m_top[i]);
+		}
+		
+		// Make room for `count' widgets.
+		void reserve(size_t count)
+		{
+			m_nodes.reserve(count);
+		}
+		
+		// Construct a widget in a pool block of `size' bytes. Its parent is the widget added as `parent', which must have been
+		// added before it, or the builder's parent with NO_PARENT. Returns the index of the new widget.
+		size_t add(Constructor construct, size_t size, size_t parent = NO_PARENT)
+		{
+			return this->addInBlock(construct, this->getPool()->allocate(size), size, parent);
+		}
+		
+		// Construct a widget of type W. Returns its index.
+		template <typename W>
+		size_t add(size_t parent = NO_PARENT)
+		{
+			static_assert(alignof(W) <= WidgetPool::GRANULARITY, "Widget type is over-aligned for the widget pool.");
+			
+			return this->add(&constructWidget<W>, sizeof(W), parent);
+		}
+		
+		// Like add(), but construct the widget in a block already allocated from getPool(), which is given back with
+		// `blockSize' when the widget is destroyed. Used to construct widgets in a batch, see WidgetPool::allocateBatch().
+		size_t addInBlock(Constructor construct, void* block, size_t blockSize, size_t parent = NO_PARENT)
+		{
+			BasicWidget* widget = construct(block);
+			widget->m_internals.pool = this->getPool();
+			widget->m_internals.blockSize = static_cast<unsigned int>(blockSize);
+			
+			// Join the parent's dispatch mode now, so the whole subtree doesn't have to be visited when it is attached.
+			if (widget->m_internals.dispatch != m_parent.m_internals.dispatch)
+				widget->setDispatchFlags(m_parent.m_internals.dispatch);
+			
+			if (parent < m_nodes.size())
+			{
+				this->link(m_nodes[parent], widget);
+			}
+			else
+			{
+				// The last top-level widget will be the focused one.
+				if (!m_top.empty())
+					m_parent.focusMoved(m_top.back(), widget);
+				
+				m_top.push_back(widget);
+			}
+			
+			m_nodes.push_back(widget);
+			
+			return m_nodes.size() - 1;
+		}
+		
+		// Set the bounds of a widget, without any events.
+		void setBounds(size_t idx, T bx, T by, T bwidth, T bheight)
+		{
+			BasicWidget* widget = m_nodes[idx];
+			BasicWidget* parent = widget->m_internals.parent;
+			
+			widget->x = bx;
+			widget->y = by;
+			widget->width = bwidth;
+			widget->height = bheight;
+			
+			if (!parent)
+				return;
+			
+			if (parent->m_internals.index)
+				parent->m_internals.index->update(widget);
+			
+			parent->m_internals.widgets.updateBounds(widget);
+			parent->forgetChildExtent();
+		}
+		
+		// Get a widget by index.
+		BasicWidget* getWidget(size_t idx) const
+		{
+			return m_nodes[idx];
+		}
+		
+		// Get the pool of the parent's tree, which widgets are constructed in.
+		WidgetPool* getPool()
+		{
+			if (!m_pool)
+			{
+				TreeState& tree = m_parent.getRoot()->getTreeState();
+				if (!tree.pool)
+					tree.pool = new WidgetPool();
+				
+				m_pool = tree.pool;
+			}
+			
+			return m_pool;
+		}
+		
+		// Get the number of widgets added since the last finish().
+		size_t getNumOfWidgets() const
+		{
+			return m_nodes.size();
+		}
+		
+		// Attach the top-level widgets added so far to the parent, holding their events back until finish(). Widgets added
+		// afterwards must not have an attached widget as their parent.
+		void attach()
+		{
+			if (m_top.empty())
+				return;
+			
+			m_parent.addWidgets(&m_top[0], m_top.size(), false);
+			m_top.clear();
+		}
+		
+		// Attach the top-level widgets to the parent, then send the events that were held back. Without `geometryEvents',
+		// the bounds set in the builder count as the widgets' initial geometry and get no onMove() or onResize().
+		// The builder can be used again afterwards.
+		void finish(bool geometryEvents = true)
+		{
+			if (m_nodes.empty())
+				return;
+			
+			this->attach();
+			
+			// Events may add more widgets to the builder.
+			std::vector<BasicWidget*> nodes;
+			nodes.swap(m_nodes);
+			
+			for (size_t i = 0, sz = nodes.size(); i < sz; ++i)
+			{
+				BasicWidget* widget = nodes[i];
+				BasicWidget* parent = widget->m_internals.parent;
+				
+				parent->onAdopt(*widget);
+				widget->onAdopted(*parent);
+				
+				if (!geometryEvents)
+					continue;
+				
+				if (widget->x != T(0) || widget->y != T(0))
+					widget->onMove(widget->x, widget->y);
+				
+				if (widget->width != T(0) || widget->height != T(0))
+					widget->onResize();
+			}
+			
+			// Keep the memory for the next widgets, unless events added some already.
+			if (m_nodes.empty())
+			{
+				nodes.clear();
+				m_nodes.swap(nodes);
+			}
+		}
+		
+		// Construct a W in `memory'.
+		template <typename W>
+		static BasicWidget* constructWidget(void* memory)
+		{
+			return new (memory) W();
+		}
+		
+	private:
+		
+		BasicWidget& m_parent;
+		WidgetPool* m_pool;
+		std::vector<BasicWidget*> m_nodes;
+		std::vector<BasicWidget*> m_top;  /* Widgets added with NO_PARENT, attached by finish(). */
+		
+		// Add a new widget to the back of a parent in the builder, the way addWidget() would, minus the events.
+		// Neither is part of a tree yet, so there is nothing to invalidate, and only the parents in the builder are counted.
+		static void link(BasicWidget* parent, BasicWidget* widget)
+		{
+			BasicWidget* oldFocus = parent->getFocused();
+			
+			parent->m_internals.widgets.push_back(widget);
+			widget->m_internals.parent = parent;
+			
+			if (parent->m_internals.zcounter == UINT_MAX)
+				parent->renumberZOrder();
+			
+			widget->m_internals.zorder = ++parent->m_internals.zcounter;
+			parent->focusMoved(oldFocus, widget);
+			parent->m_internals.hoverDirty = true;
+			parent->forgetChildExtent();
+			widget->refreshHidden();
+			
+			if (parent->m_internals.index)
+				parent->m_internals.index->insert(widget);
+			
+			for (int c = 0; c < NUM_SUBTREE_COUNTERS; ++c)
+			{
+				unsigned int count = widget->m_internals.counts[c];
+				
+				for (BasicWidget* cur = parent; count && cur; cur = cur->m_internals.parent)
+					cur->m_internals.counts[c] += count;
+			}
+		}
+		
+		// Builders are not copyable.
+		BulkBuilder(const BulkBuilder&);
+		BulkBuilder& operator=(const BulkBuilder&);
+	};
+	
 private:
 	
-	// Widget UI internal variables.
-	struct
+	// Uniform grid over the bounds of a widget's children.
+	// Used to find the child under a point without testing every child of wide containers.
+	class ChildIndex
+	{
+	private:
+		
+		// Cell range a child was inserted with. An empty range means the child was not inserted into any cell.
+		struct CellRange
+		{
+			int x0, y0, x1, y1;
+			bool large;
+		};
+		
+		// Children spanning more cells than this are kept in a separate list and always tested.
+		static const int MAX_CELLS_PER_CHILD = 64;
+		
+		typedef std::unordered_map<long long, std::vector<BasicWidget*> > CellMap;
+		typedef std::unordered_map<const BasicWidget*, CellRange> RangeMap;
+		
+		double m_cellSize;
+		CellMap m_cells;
+		RangeMap m_ranges;
+		std::vector<BasicWidget*> m_large;
+		
+		int cellCoord(T v) const
+		{
+			double c = std::floor(static_cast<double>(v) / m_cellSize);
+			
+			// Keep far away (or non-finite) coordinates representable.
+			if (!(c > -1073741824.))
+				return -1073741824;
+			if (!(c < 1073741824.))
+				return 1073741824;
+			
+			return static_cast<int>(c);
+		}
+		
+		static long long cellKey(int cx, int cy)
+		{
+			return (static_cast<long long>(cx) << 32) ^ static_cast<long long>(static_cast<unsigned int>(cy));
+		}
+		
+		static void eraseFrom(std::vector<BasicWidget*>& list, const BasicWidget* widget)
+		{
+			for (size_t i = list.size(); i--;)
+			{
+				if (list[i] == widget)
+				{
+					list[i] = list.back();
+					list.pop_back();
+					return;
+				}
+			}
+		}
+		
+	public:
+		
+		explicit ChildIndex(T cellSize)
+			: m_cellSize(cellSize > T(0) ? static_cast<double>(cellSize) : 64.)
+		{
+			
+		}
+		
+		T getCellSize() const
+		{
+			return static_cast<T>(m_cellSize);
+		}
+		
+		void insert(BasicWidget* widget)
+		{
+			CellRange range;
+			range.x0 = 0; range.y0 = 0;
+			range.x1 = -1; range.y1 = -1;
+			range.large = false;
+			
+			// Empty widgets can never be hit, no need to put them in any cell.
+			if (widget->width > T(0) && widget->height > T(0))
+			{
+				range.x0 = cellCoord(widget->x);
+				range.y0 = cellCoord(widget->y);
+				range.x1 = cellCoord(widget->x + widget->width);
+				range.y1 = cellCoord(widget->y + widget->height);
+				
+				if (static_cast<double>(range.x1 - range.x0 + 1) * (range.y1 - range.y0 + 1) > MAX_CELLS_PER_CHILD)
+				{
+					range.large = true;
+					m_large.push_back(widget);
+				}
+				else
+				{
+					for (int cy = range.y0; cy <= range.y1; ++cy)
+						for (int cx = range.x0; cx <= range.x1; ++cx)
+							m_cells[cellKey(cx, cy)].push_back(widget);
+				}
+			}
+			
+			m_ranges[widget] = range;
+		}
+		
+		void clear()
+		{
+			m_cells.clear();
+			m_ranges.clear();
+			m_large.clear();
+		}
+		
+		void remove(const BasicWidget* widget)
+		{
+			typename RangeMap::iterator it = m_ranges.find(widget);
+			
+			if (it == m_ranges.end())
+				return;
+			
+			const CellRange& range = it->second;
+			
+			if (range.large)
+			{
+				eraseFrom(m_large, widget);
+			}
+			else
+			{
+				for (int cy = range.y0; cy <= range.y1; ++cy)
+				{
+					for (int cx = range.x0; cx <= range.x1; ++cx)
+					{
+						typename CellMap::iterator cell = m_cells.find(cellKey(cx, cy));
+						
+						if (cell == m_cells.end())
+							continue;
+						
+						eraseFrom(cell->second, widget);
+						
+						if (cell->second.empty())
+							m_cells.erase(cell);
+					}
+				}
+			}
+			
+			m_ranges.erase(it);
+		}
+		
+		void update(BasicWidget* widget)
+		{
+			this->remove(widget);
+			this->insert(widget);
+		}
+		
+		// Find the top-most child containing [x, y]. Top-most is the child with the highest z-order.
+		BasicWidget* hitTest(T x, T y, bool skipHidden) const
+		{
+			BasicWidget* best = NULL;
+			
+			typename CellMap::const_iterator cell = m_cells.find(cellKey(cellCoord(x), cellCoord(y)));
+			
+			if (cell != m_cells.end())
+				best = pickTop(cell->second, x, y, skipHidden, best);
+			
+			return pickTop(m_large, x, y, skipHidden, best);
+		}
+		
+	private:
+		
+		static BasicWidget* pickTop(const std::vector<BasicWidget*>& list, T x, T y, bool skipHidden, BasicWidget* best)
+		{
+			BasicWidget* widget;
+			
+			for (size_t i = 0, sz = list.size(); i < sz; ++i)
+			{
+				widget = list[i];
+				
+				if (best && widget->m_internals.zorder < best->m_internals.zorder)
+					continue;
+				
+				if (skipHidden && widget->m_internals.hidden)
+					continue;
+				
+				if (x >= widget->x && x < widget->x + widget->width &&
+					y >= widget->y && y < widget->y + widget->height )
+				{
+					best = widget;
+				}
+			}
+			
+			return best;
+		}
+		
+	};
+	
+	// Properties counted over whole subtrees, so dispatch can skip subtrees that don't need an event.
+	enum SubtreeCounter
+	{
+		COUNT_KEY_SNOOPERS,
+		COUNT_MOUSE_TRACKERS,
+		COUNT_PRESS_WATCHERS,
+		COUNT_PRESSED,
+		COUNT_CAPTURING,          /* Widgets that captured the pointer. */
+		COUNT_AWAKE,              /* Widgets that want onUpdate() this frame. */
+		COUNT_SCHEDULED,          /* Widgets waiting on scheduleUpdate(). */
+		
+		NUM_SUBTREE_COUNTERS
+	};
+	
+	// Hit-test blocks of packed bounds from `i' downwards, while at least a full SIMD vector is left.
+	// Only float and double coordinates have SIMD versions; other types fall through to the scalar loop.
+	template <typename U>
+	static bool hitTestBlocks(const U*, const U*, const U*, const U*, U, U, size_t&, size_t&)
+	{
+		return false;
+	}
+	
+#if defined(WIDGET_SIMD_AVX)
+	
+	static bool hitTestBlocks(const double* x0, const double* y0, const double* x1, const double* y1, double x, double y, size_t& i, size_t& out_idx)
+	{
+		__m256d px = _mm256_set1_pd(x), py = _mm256_set1_pd(y);
+		
+		while (i >= 4)
+		{
+			i -= 4;
+			
+			__m256d in = _mm256_and_pd(
+				_mm256_and_pd(_mm256_cmp_pd(px, _mm256_loadu_pd(x0 + i), _CMP_GE_OQ), _mm256_cmp_pd(px, _mm256_loadu_pd(x1 + i), _CMP_LT_OQ)),
+				_mm256_and_pd(_mm256_cmp_pd(py, _mm256_loadu_pd(y0 + i), _CMP_GE_OQ), _mm256_cmp_pd(py, _mm256_loadu_pd(y1 + i), _CMP_LT_OQ)) );
+			
+			int mask = _mm256_movemask_pd(in);
+			
+			if (mask)
+			{
+				out_idx = i + highestBit(mask);
+				return true;
+			}
+		}
+		
+		return false;
+	}
+	
+	static bool hitTestBlocks(const float* x0, const float* y0, const float* x1, const float* y1, float x, float y, size_t& i, size_t& out_idx)
+	{
+		__m256 px = _mm256_set1_ps(x), py = _mm256_set1_ps(y);
+		
+		while (i >= 8)
+		{
+			i -= 8;
+			
+			__m256 in = _mm256_and_ps(
+				_mm256_and_ps(_mm256_cmp_ps(px, _mm256_loadu_ps(x0 + i), _CMP_GE_OQ), _mm256_cmp_ps(px, _mm256_loadu_ps(x1 + i), _CMP_LT_OQ)),
+				_mm256_and_ps(_mm256_cmp_ps(py, _mm256_loadu_ps(y0 + i), _CMP_GE_OQ), _mm256_cmp_ps(py, _mm256_loadu_ps(y1 + i), _CMP_LT_OQ)) );
+			
+			int mask = _mm256_movemask_ps(in);
+			
+			if (mask)
+			{
+				out_idx = i + highestBit(mask);
+				return true;
+			}
+		}
+		
+		return false;
+	}
+	
+#elif defined(WIDGET_SIMD_SSE2)
+	
+	static bool hitTestBlocks(const double* x0, const double* y0, const double* x1, const double* y1, double x, double y, size_t& i, size_t& out_idx)
+	{
+		__m128d px = _mm_set1_pd(x), py = _mm_set1_pd(y);
+		
+		while (i >= 2)
+		{
+			i -= 2;
+			
+			__m128d in = _mm_and_pd(
+				_mm_and_pd(_mm_cmpge_pd(px, _mm_loadu_pd(x0 + i)), _mm_cmplt_pd(px, _mm_loadu_pd(x1 + i))),
+				_mm_and_pd(_mm_cmpge_pd(py, _mm_loadu_pd(y0 + i)), _mm_cmplt_pd(py, _mm_loadu_pd(y1 + i))) );
+			
+			int mask = _mm_movemask_pd(in);
+			
+			if (mask)
+			{
+				out_idx = i + highestBit(mask);
+				return true;
+			}
+		}
+		
+		return false;
+	}
+	
+	static bool hitTestBlocks(const float* x0, const float* y0, const float* x1, const float* y1, float x, float y, size_t& i, size_t& out_idx)
+	{
+		__m128 px = _mm_set1_ps(x), py = _mm_set1_ps(y);
+		
+		while (i >= 4)
+		{
+			i -= 4;
+			
+			__m128 in = _mm_and_ps(
+				_mm_and_ps(_mm_cmpge_ps(px, _mm_loadu_ps(x0 + i)), _mm_cmplt_ps(px, _mm_loadu_ps(x1 + i))),
+				_mm_and_ps(_mm_cmpge_ps(py, _mm_loadu_ps(y0 + i)), _mm_cmplt_ps(py, _mm_loadu_ps(y1 + i))) );
+			
+			int mask = _mm_movemask_ps(in);
+			
+			if (mask)
+			{
+				out_idx = i + highestBit(mask);
+				return true;
+			}
+		}
+		
+		return false;
+	}
+	
+#endif
+	
+	// Index of the highest set bit of a (non-zero) SIMD lane mask.
+	static size_t highestBit(int mask)
+	{
+		size_t bit = 0;
+		
+		while (mask >>= 1)
+			++bit;
+		
+		return bit;
+	}
+	
+	// Bounds of a widget's children, kept in contiguous arrays in the same order as the children.
+	// Lets hit-tests run over several children at once without touching the children themselves.
+	class ChildBounds
+	{
+	private:
+		
+		std::vector<T> m_x0, m_y0, m_x1, m_y1;
+		
+	public:
+		
+		size_t size() const
+		{
+			return m_x0.size();
+		}
+		
+		void resize(size_t sz)
+		{
+			m_x0.resize(sz);
+			m_y0.resize(sz);
+			m_x1.resize(sz);
+			m_y1.resize(sz);
+		}
+		
+		void set(size_t i, const BasicWidget* widget)
+		{
+			m_x0[i] = widget->x;
+			m_y0[i] = widget->y;
+			m_x1[i] = widget->x + widget->width;
+			m_y1[i] = widget->y + widget->height;
+		}
+		
+		// Empty bounds, which never contain any point.
+		void clear(size_t i)
+		{
+			m_x0[i] = m_y0[i] = m_x1[i] = m_y1[i] = T(0);
+		}
+		
+		// Find the highest index below `end' whose bounds contain [x, y].
+		bool hitTest(T x, T y, size_t end, size_t& out_idx) const
+		{
+			size_t i = end;
+			
+			if (i && hitTestBlocks(&m_x0[0], &m_y0[0], &m_x1[0], &m_y1[0], x, y, i, out_idx))
+				return true;
+			
+			while (i--)
+			{
+				if (x >= m_x0[i] && x < m_x1[i] && y >= m_y0[i] && y < m_y1[i])
+				{
+					out_idx = i;
+					return true;
+				}
+			}
+			
+			return false;
+		}
+	};
+	
+	// The children of a widget, in z-order. The back-most child is focused and/or top.
+	// Removing or raising a child leaves a hole (NULL) in its old slot instead of shifting every child after it.
+	// Holes are squeezed out once they outnumber the children, or when a child is looked up by index.
+	// The first few slots are kept inline, so widgets with only a handful of children don't allocate.
+	class ChildList
+	{
+	private:
+		
+		static const unsigned int INLINE_SLOTS = 3;
+		
+		BasicWidget** m_slots;             /* Never ends with a hole. Points to m_inline until more slots are needed. */
+		ChildBounds* m_bounds;             /* Optional packed copy of the children's bounds, slot for slot. */
+		unsigned int m_size;               /* Number of slots in use. */
+		unsigned int m_capacity;
+		unsigned int m_count;
+		BasicWidget* m_inline[INLINE_SLOTS];
+		
+	public:
+		
+		ChildList()
+			: m_slots(m_inline), m_bounds(NULL), m_size(0), m_capacity(INLINE_SLOTS), m_count(0)
+		{
+			
+		}
+		
+		~ChildList()
+		{
+			if (m_slots != m_inline)
+				delete[] m_slots;
+			
+			delete m_bounds;
+		}
+		
+		// Number of slots, including holes.
+		size_t size() const
+		{
+			return m_size;
+		}
+		
+		// Get the child in a slot. NULL if the slot is a hole.
+		BasicWidget* operator[](size_t i) const
+		{
+			return m_slots[i];
+		}
+		
+		// Number of children.
+		size_t count() const
+		{
+			return m_count;
+		}
+		
+		bool empty() const
+		{
+			return m_count == 0;
+		}
+		
+		// Get the back-most child. The list must not be empty.
+		BasicWidget* back() const
+		{
+			return m_slots[m_size - 1];
+		}
+		
+		// Get the child at an index, not counting holes.
+		BasicWidget* at(size_t idx)
+		{
+			if (m_count != m_size)
+				this->compact();
+			
+			return m_slots[idx];
+		}
+		
+		// Get the child in front of `widget' (the next one towards the front.) Returns NULL if there is none.
+		BasicWidget* previous(const BasicWidget* widget) const
+		{
+			for (size_t i = widget->m_internals.slot; i--;)
+			{
+				if (m_slots[i])
+					return m_slots[i];
+			}
+			
+			return NULL;
+		}
+		
+		void push_back(BasicWidget* widget)
+		{
+			if (m_size == m_capacity)
+				this->grow();
+			
+			widget->m_internals.slot = m_size;
+			m_slots[m_size++] = widget;
+			++m_count;
+			
+			if (m_bounds)
+			{
+				m_bounds->resize(m_size);
+				m_bounds->set(widget->m_internals.slot, widget);
+			}
+		}
+		
+		void erase(BasicWidget* widget)
+		{
+			size_t i = widget->m_internals.slot;
+			
+			m_slots[i] = NULL;
+			--m_count;
+			
+			if (m_bounds)
+				m_bounds->clear(i);
+			
+			// Don't leave holes at the back, so back() is always a child.
+			while (m_size && !m_slots[m_size - 1])
+				--m_size;
+			
+			if (m_bounds)
+				m_bounds->resize(m_size);
+			
+			if (m_size - m_count > m_count)
+				this->compact();
+		}
+		
+		// Make room for `sz' slots, so adding children up to that many doesn't grow the list again.
+		void reserve(size_t sz)
+		{
+			if (sz > m_capacity)
+				this->grow(static_cast<unsigned int>(sz));
+		}
+		
+		// Remove all children. Slots allocated on the heap are kept.
+		void clear()
+		{
+			m_size = 0;
+			m_count = 0;
+			this->rebuildBounds();
+		}
+		
+		// Move a child to the back.
+		void raise(BasicWidget* widget)
+		{
+			this->erase(widget);
+			this->push_back(widget);
+		}
+		
+		// Squeeze out all holes. Order is kept.
+		void compact()
+		{
+			unsigned int n = 0;
+			
+			for (unsigned int i = 0; i < m_size; ++i)
+			{
+				if (!m_slots[i])
+					continue;
+				
+				m_slots[n] = m_slots[i];
+				m_slots[n]->m_internals.slot = n;
+				++n;
+			}
+			
+			m_size = n;
+			this->rebuildBounds();
+		}
+		
+		// Enable or disable the packed bounds.
+		void setPacked(bool enabled)
+		{
+			delete m_bounds;
+			m_bounds = enabled ? new ChildBounds() : NULL;
+			
+			this->rebuildBounds();
+		}
+		
+		const ChildBounds* getBounds() const
+		{
+			return m_bounds;
+		}
+		
+		// Copy a child's bounds into the packed bounds.
+		void updateBounds(const BasicWidget* widget)
+		{
+			if (m_bounds)
+				m_bounds->set(widget->m_internals.slot, widget);
+		}
+		
+	private:
+		
+		// Double the number of slots (or more, up to `minCapacity'), moving them to the heap.
+		void grow(unsigned int minCapacity = 0)
+		{
+			unsigned int capacity = std::max(m_capacity * 2, minCapacity);
+			BasicWidget** slots = new BasicWidget*[capacity];
+			
+			std::copy(m_slots, m_slots + m_size, slots);
+			
+			if (m_slots != m_inline)
+				delete[] m_slots;
+			
+			m_slots = slots;
+			m_capacity = capacity;
+		}
+		
+		void rebuildBounds()
+		{
+			if (!m_bounds)
+				return;
+			
+			m_bounds->resize(m_size);
+			
+			for (size_t i = 0, sz = m_size; i < sz; ++i)
+			{
+				if (m_slots[i])
+					m_bounds->set(i, m_slots[i]);
+				else
+					m_bounds->clear(i);
+			}
+		}
+		
+		// Child lists are not copyable.
+		ChildList(const ChildList&);
+		ChildList& operator=(const ChildList&);
+		
+	};
+	
+	// A grid over the screen bounds of every visible widget of a tree, for widgetAt() and widgetsInRect().
+	// Built in one pass over the tree, and built again once the tree stops changing between queries. (See getScreenIndex().)
+	class ScreenIndex
+	{
+	private:
+		
+		// A widget's screen bounds, clipped to its parents, since it can only be hit inside of them.
+		struct Entry
+		{
+			BasicWidget* widget;
+			Rect rect;
+		};
+		
+		// A widget waiting to be visited while building, at [absx, absy] on the screen.
+		struct Visit
+		{
+			Entry entry;
+			T absx, absy;
+		};
+		
+		// Entries spanning more cells than this are kept in a separate list and always tested.
+		static const unsigned int MAX_CELLS_PER_ENTRY = 64;
+		static const unsigned int MAX_CELLS_PER_AXIS = 256;
+		
+		std::vector<Entry> m_entries;            /* In drawing order. */
+		std::vector<unsigned int> m_cellStart;   /* Where each cell's entries start in m_cellEntries, plus one past the end. */
+		std::vector<unsigned int> m_cellEntries; /* Entries of every cell, in drawing order within a cell. */
+		std::vector<unsigned int> m_large;
+		std::vector<unsigned int> m_marks;       /* Query that last found an entry. */
+		unsigned int m_mark;
+		
+		Rect m_bounds;
+		unsigned int m_cols, m_rows;
+		double m_cellWidth, m_cellHeight; /* Cells are worked out in double, like ChildIndex, so any coordinate type works. */
+		unsigned long m_version;  /* Geometry version of the tree the index was built at. */
+		unsigned long m_queried;  /* Geometry version of the tree at the last query. */
+		
+		unsigned int cellX(T v) const
+		{
+			double c = static_cast<double>(v - m_bounds.x) / m_cellWidth;
+			return (c > 0.) ? ((c < double(m_cols)) ? static_cast<unsigned int>(c) : m_cols - 1) : 0;
+		}
+		
+		unsigned int cellY(T v) const
+		{
+			double c = static_cast<double>(v - m_bounds.y) / m_cellHeight;
+			return (c > 0.) ? ((c < double(m_rows)) ? static_cast<unsigned int>(c) : m_rows - 1) : 0;
+		}
+		
+		static bool contains(const Rect& rect, T x, T y)
+		{
+			return x >= rect.x && x < rect.x + rect.width && y >= rect.y && y < rect.y + rect.height;
+		}
+		
+	public:
+		
+		ScreenIndex()
+			: m_mark(0), m_cols(0), m_rows(0), m_cellWidth(1.), m_cellHeight(1.), m_version(0), m_queried(0)
+		{
+			
+		}
+		
+		// Was the index built at this geometry version?
+		bool isCurrent(unsigned long version) const
+		{
+			return m_version == version;
+		}
+		
+		// Was the tree already at this geometry version at the last query? Remembers the version for the next call.
+		bool wasQueried(unsigned long version)
+		{
+			bool queried = (m_queried == version);
+			m_queried = version;
+			return queried;
+		}
+		
+		// Collect the visible widgets of the tree below `root', and sort them into cells.
+		void build(BasicWidget* root, unsigned long version)
+		{
+			m_entries.clear();
+			m_cellEntries.clear();
+			m_large.clear();
+			m_version = version;
+			m_cols = m_rows = 0;
+			
+			// Walk the tree in drawing order, working out absolute positions on the way.
+			std::vector<Visit> stack;
+			Visit top;
+			top.entry.widget = root;
+			top.entry.rect = Rect(root->x, root->y, root->width, root->height);
+			top.absx = root->x;
+			top.absy = root->y;
+			
+			if (!root->m_internals.hidden && !top.entry.rect.isEmpty())
+				stack.push_back(top);
+			
+			while (!stack.empty())
+			{
+				Visit visit = stack.back();
+				stack.pop_back();
+				
+				BasicWidget* widget = visit.entry.widget;
+				
+				m_entries.push_back(visit.entry);
+				
+				for (size_t i = widget->m_internals.widgets.size(); i--;)
+				{
+					BasicWidget* child = widget->m_internals.widgets[i];
+					
+					if (!child || child->m_internals.hidden)
+						continue;
+					
+					Visit next;
+					next.absx = visit.absx + child->x;
+					next.absy = visit.absy + child->y;
+					next.entry.widget = child;
+					next.entry.rect = Rect(next.absx, next.absy, child->width, child->height);
+					next.entry.rect.clip(visit.entry.rect);
+					
+					// Nothing of it, or below it, can be hit.
+					if (next.entry.rect.isEmpty())
+						continue;
+					
+					stack.push_back(next);
+				}
+			}
+			
+			if (m_entries.empty())
+				return;
+			
+			// Aim for a couple of entries per cell.
+			m_bounds = m_entries[0].rect;
+			
+			unsigned int side = static_cast<unsigned int>(std::ceil(std::sqrt(m_entries.size() / 2.)));
+			m_cols = m_rows = (side < 1) ? 1 : ((side > MAX_CELLS_PER_AXIS) ? MAX_CELLS_PER_AXIS : side);
+			m_cellWidth = static_cast<double>(m_bounds.width) / m_cols;
+			m_cellHeight = static_cast<double>(m_bounds.height) / m_rows;
+			
+			if (!(m_cellWidth > 0.) || !(m_cellHeight > 0.))
+			{
+				m_cols = m_rows = 1;
+				m_cellWidth = static_cast<double>(m_bounds.width);
+				m_cellHeight = static_cast<double>(m_bounds.height);
+			}
+			
+			// Count the entries of each cell, then fill them in.
+			m_cellStart.assign(m_cols * m_rows + 1, 0);
+			
+			for (int pass = 0; pass < 2; ++pass)
+			{
+				for (size_t i = 0, sz = m_entries.size(); i < sz; ++i)
+				{
+					const Rect& rect = m_entries[i].rect;
+					unsigned int x0 = cellX(rect.x), x1 = cellX(rect.x + rect.width);
+					unsigned int y0 = cellY(rect.y), y1 = cellY(rect.y + rect.height);
+					
+					if ((x1 - x0 + 1) * (y1 - y0 + 1) > MAX_CELLS_PER_ENTRY)
+					{
+						if (pass == 0)
+							m_large.push_back(static_cast<unsigned int>(i));
+						
+						continue;
+					}
+					
+					for (unsigned int cy = y0; cy <= y1; ++cy)
+					{
+						for (unsigned int cx = x0; cx <= x1; ++cx)
+						{
+							if (pass == 0)
+								++m_cellStart[cy * m_cols + cx + 1];
+							else
+								m_cellEntries[m_cellStart[cy * m_cols + cx]++] = static_cast<unsigned int>(i);
+						}
+					}
+				}
+				
+				if (pass == 0)
+				{
+					for (size_t c = 1; c < m_cellStart.size(); ++c)
+						m_cellStart[c] += m_cellStart[c - 1];
+					
+					m_cellEntries.resize(m_cellStart.back());
+				}
+				else
+				{
+					// Filling moved each start up to the next cell's, move them back.
+					for (size_t c = m_cellStart.size() - 1; c > 0; --c)
+						m_cellStart[c] = m_cellStart[c - 1];
+					
+					m_cellStart[0] = 0;
+				}
+			}
+			
+			m_marks.assign(m_entries.size(), 0);
+			m_mark = 0;
+		}
+		
+		// Get the top-most widget at a point.
+		BasicWidget* hitTest(T x, T y) const
+		{
+			if (m_entries.empty() || !contains(m_bounds, x, y))
+				return NULL;
+			
+			unsigned int cell = cellY(y) * m_cols + cellX(x);
+			size_t best = 0;
+			
+			// Later entries are drawn on top, look from the back.
+			for (size_t i = m_cellStart[cell + 1]; i-- > m_cellStart[cell];)
+			{
+				if (contains(m_entries[m_cellEntries[i]].rect, x, y))
+				{
+					best = m_cellEntries[i];
+					break;
+				}
+			}
+			
+			for (size_t i = m_large.size(); i--;)
+			{
+				if (m_large[i] <= best)
+					break;
+				
+				if (contains(m_entries[m_large[i]].rect, x, y))
+				{
+					best = m_large[i];
+					break;
+				}
+			}
+			
+			// The first entry (the root) covers the whole grid.
+			return m_entries[best].widget;
+		}
+		
+		// Add every widget overlapping a rectangle to `out', in drawing order.
+		void query(const Rect& rect, std::vector<BasicWidget*>& out)
+		{
+			if (m_entries.empty() || !rect.intersects(m_bounds))
+				return;
+			
+			// Entries spanning several cells are only taken once.
+			if (++m_mark == 0)
+			{
+				m_marks.assign(m_entries.size(), 0);
+				m_mark = 1;
+			}
+			
+			std::vector<unsigned int> found;
+			
+			for (size_t i = 0, sz = m_large.size(); i < sz; ++i)
+			{
+				if (rect.intersects(m_entries[m_large[i]].rect))
+					found.push_back(m_large[i]);
+			}
+			
+			unsigned int x0 = cellX(rect.x), x1 = cellX(rect.x + rect.width);
+			unsigned int y0 = cellY(rect.y), y1 = cellY(rect.y + rect.height);
+			
+			for (unsigned int cy = y0; cy <= y1; ++cy)
+			{
+				for (unsigned int cx = x0; cx <= x1; ++cx)
+				{
+					unsigned int cell = cy * m_cols + cx;
+					
+					for (size_t i = m_cellStart[cell], end = m_cellStart[cell + 1]; i < end; ++i)
+					{
+						unsigned int e = m_cellEntries[i];
+						
+						if (m_marks[e] != m_mark && rect.intersects(m_entries[e].rect))
+						{
+							m_marks[e] = m_mark;
+							found.push_back(e);
+						}
+					}
+				}
+			}
+			
+			std::sort(found.begin(), found.end());
+			
+			for (size_t i = 0, sz = found.size(); i < sz; ++i)
+				out.push_back(m_entries[found[i]].widget);
+		}
+		
+	};
+	
+	// Damage lists longer than this get collapsed into a single rectangle.
+	static const size_t MAX_DAMAGE_RECTS = 16;
+	
+	// A held-down widget, or a widget that captured the pointer. See DISPATCH_CAPTURED_MOUSE_UP.
+	struct Capture
+	{
+		BasicWidget* widget;
+		unsigned int button;      /* Button holding the widget down. */
+		bool pointer;             /* Captured with capturePointer(), for every button. */
+	};
+	
+	// Held-down counter changes made while a mouse down or up is being sent, still to be added to `from' and its parents.
+	// Widgets are pressed and released from the bottom of the tree up, so each one takes over the changes below it, and the
+	// whole path is only walked once. (See setHeldDown().)
+	struct PendingPress
+	{
+		bool active;              /* A mouse down or up is being sent. */
+		BasicWidget* from;
+		int delta;
+	};
+	
+	// A step on the way from the widget receiving a mouse up to a captured widget.
+	struct CaptureEdge
+	{
+		BasicWidget* parent;
+		BasicWidget* child;
+		
+		// Ordered by parent, then back to front like the children.
+		bool operator<(const CaptureEdge& other) const
+		{
+			if (parent != other.parent)
+				return parent < other.parent;
+			
+			return child->m_internals.slot < other.child->m_internals.slot;
+		}
+	};
+	
+	// State only kept by the root of a tree, allocated on first use.
+	struct TreeState
+	{
+		bool trackDamage;
+		bool fullDamage;
+		std::vector<Rect> damage;
+		
+		unsigned long changes;    /* Bumped whenever anything in the tree is invalidated, even if nothing is damaged. */
+		
+		WidgetPool* pool;         /* Memory for widgets made with create(). NULL until needed. */
+		
+		std::vector<InputEvent> input;        /* Queued input, after merging. */
+		std::vector<InputEvent> inputHistory; /* Every raw event behind `input'. */
+		std::vector<InputEvent> batch;        /* Input being (or last) processed. */
+		std::vector<InputEvent> batchHistory;
+		const InputEvent* currentInput;       /* Event being dispatched by processInput(). */
+		unsigned int coalescing;
+		
+		UpdateExecutor* executor; /* Runs parallel updates. NULL for serial updates. */
+		
+		bool hasViewport;
+		Rect viewport;            /* Area the tree is drawn into. See setViewport(). */
+		
+		ScreenIndex* screenIndex; /* For widgetAt() and widgetsInRect(). NULL until needed. */
+		std::atomic<unsigned long> geometry; /* Changed whenever anything in the tree moves. See geometryChanged(). */
+		
+		std::vector<Capture> captures;        /* Held-down and capturing widgets, in the order they were pressed. */
+		std::vector<CaptureEdge> release;     /* Paths the current mouse up travels along. */
+		
+		InputListener* listener;  /* Sees the input given to the root. See setInputListener(). */
+		
+#if defined(WIDGET_ENABLE_STATS)
+		Stats stats;
+#endif
+		
+		TreeState()
+			: trackDamage(false), fullDamage(false), changes(0), pool(NULL), currentInput(NULL),
+			  coalescing(COALESCE_MOUSE_MOVE | COALESCE_MOUSE_WHEEL), executor(NULL), hasViewport(false),
+			  screenIndex(NULL), geometry(newGeometryVersion()), listener(NULL)
+		{
+			
+		}
+		
+		~TreeState()
+		{
+			// Widgets still using the pool keep it alive.
+			if (pool)
+				pool->release();
+			
+			delete screenIndex;
+		}
+	};
+	
+	// Per-thread state of an update with an executor.
+	// The calling thread has the executor. Each parallel subtree gets its own pass, which collects what it changes outside of
+	// the subtree (counters of the parents, damage) so the calling thread can apply it after the join, in a fixed order.
+	struct UpdatePass
+	{
+		UpdateExecutor* executor; /* NULL inside a parallel subtree, where updates run serially. */
+		BasicWidget* top;         /* The parallel subtree. NULL on the calling thread. */
+		
+		unsigned int counts[NUM_SUBTREE_COUNTERS]; /* Counters of `top' before updating. */
+		std::vector<Rect> damage; /* Invalidated areas, in screen coordinates. */
+		bool damageAll;
+		bool extentChanged;       /* The extent of `top' changed, its parents' cached extents are forgotten after the join. */
+		bool boundsChanged;       /* `top' moved or resized, its parent's index and packed bounds are updated after the join. */
+		
+		UpdatePass()
+			: executor(NULL), top(NULL), damageAll(false), extentChanged(false), boundsChanged(false)
+		{
+			
+		}
+	};
+	
+#if defined(WIDGET_ENABLE_STATS)
+	
+	// Makes a tree's stats the active ones while an event is sent into it.
+	class EventStatsScope
+	{
+	private:
+		
+		Stats* m_saved;
+		
+	public:
+		
+		EventStatsScope(BasicWidget* widget, typename Stats::Event event)
+			: m_saved(activeStats())
+		{
+			Stats& stats = widget->getTreeState().stats;
+			++stats.calls[event];
+			activeStats() = &stats;
+		}
+		
+		~EventStatsScope()
+		{
+			activeStats() = m_saved;
+		}
+	};
+	
+	// Times an onUpdate/onDraw call, for the widget's subtree and (minus its children) for its type.
+	class TimeStatsScope
+	{
+	private:
+		
+		typedef std::chrono::steady_clock Clock;
+		
+		Stats* m_stats;
+		BasicWidget* m_widget;
+		typename Stats::Event m_event;
+		Clock::time_point m_start;
+		TimeStatsScope* m_parent;
+		double m_childTime;
+		
+	public:
+		
+		TimeStatsScope(BasicWidget* widget, typename Stats::Event event)
+			: m_stats(activeStats()), m_widget(widget), m_event(event), m_parent(NULL), m_childTime(0.)
+		{
+			if (!m_stats)
+				return;
+			
+			m_parent = activeTimer();
+			activeTimer() = this;
+			m_start = Clock::now();
+		}
+		
+		~TimeStatsScope()
+		{
+			if (!m_stats)
+				return;
+			
+			double elapsed = std::chrono::duration<double>(Clock::now() - m_start).count();
+			
+			activeTimer() = m_parent;
+			if (m_parent)
+				m_parent->m_childTime += elapsed;
+			
+			typename Stats::TypeCost& cost = m_stats->types[std::type_index(typeid(*m_widget))];
+			if (!cost.name)
+				cost.name = typeid(*m_widget).name();
+			
+			if (m_event == Stats::EVENT_UPDATE)
+			{
+				m_widget->m_internals.updateTime += elapsed;
+				++cost.updates;
+				cost.updateTime += elapsed - m_childTime;
+			}
+			else
+			{
+				m_widget->m_internals.drawTime += elapsed;
+				++cost.draws;
+				cost.drawTime += elapsed - m_childTime;
+			}
+		}
+	};
+	
+	// Stats of the tree the current event was sent into, on this thread. NULL outside of events.
+	static Stats*& activeStats()
+	{
+		static thread_local Stats* stats = NULL;
+		return stats;
+	}
+	
+	static TimeStatsScope*& activeTimer()
+	{
+		static thread_local TimeStatsScope* timer = NULL;
+		return timer;
+	}
+	
+#endif
+	
+	// Arguments of the tasks handed to the executor.
+	struct ParallelTask
+	{
+		BasicWidget* const* children;
+		UpdatePass* passes;
+		double dt;
+	};
+	
+	// Widget UI internal variables.
+	// Grouped by size, to keep padding (and the size of float widgets) down.
+	struct
+	{
+		mutable ChildList widgets;  /* Back-most widget is focused and/or top. */
+		BasicWidget* parent;
+		
+		BasicWidget* hover;
+		BasicWidget* moveTarget;  /* Child the last culled mouse move was sent to. */
+		
+		ChildIndex* index;        /* Optional spatial index over children. NULL when disabled. */
+		
+		TreeState* tree;          /* Root-only state. NULL until needed. */
+		WidgetPool* pool;         /* Pool this widget was allocated from by create(). NULL if the user owns it. */
+		DrawContext* drawCtx;     /* Set while drawing. */
+		
+		double wakeDelay;         /* Time left until a scheduled update. */
+		
+#if defined(WIDGET_ENABLE_STATS)
+		double updateTime;        /* Seconds spent updating this subtree. */
+		double drawTime;          /* Seconds spent drawing this subtree. */
+#endif
+		
+		T mouseX, mouseY;
+		
+		Rect childExtent;         /* Area covered by the visible children and their children. See getChildExtent(). */
+		
+		unsigned int slot;        /* Slot in the parent's children. */
+		unsigned int zorder;      /* Position in the parent's z-order. Higher is closer to the top. */
+		unsigned int zcounter;    /* Last z-order handed out to a child. */
+		
+		unsigned int dispatch;    /* DispatchFlags, shared by the whole tree. */
+		unsigned int counts[NUM_SUBTREE_COUNTERS]; /* Number of widgets in this subtree (including this one) with a counted property. */
+		
+		unsigned int blockSize;   /* Size of the pool block. */
+		
+		unsigned int downBtn;
+		unsigned int moveStamp;   /* Which mouse move the mouse position belongs to. */
+		
+		bool down;
+		bool mouseInsideChild;
+		bool hidden;
+		bool effHidden;           /* Hidden, or a parent is hidden. */
+		bool effFocused;          /* Focused child all the way up to the root. */
+		bool focusedChild;        /* The focused child of the parent, or no parent. */
+		bool keySnoop;            /* Receive key events even when not on the focus chain. */
+		bool mouseTrack;          /* Receive every mouse move, even when the mouse isn't over this widget. */
+		bool pressWatch;          /* Receive every mouse down, even when the mouse isn't over this widget. */
+		bool mouseCurrent;        /* Did this widget receive the latest mouse move? Worked out during update. */
+		bool hoverDirty;          /* The mouse moved, or children under it changed, since hover was last worked out. */
+		bool sleeping;            /* Only updated when woken up. */
+		bool wakePending;         /* Woken up by requestUpdate() for the next update. */
+		bool scheduled;           /* Waiting on scheduleUpdate(). */
+		bool parallelUpdate;      /* Subtree may be updated on another thread. */
+		bool clipChildren;        /* Children are clipped to this widget's bounds. */
+		bool childExtentValid;    /* `childExtent' is up to date. */
+		bool captured;            /* Captured the pointer. */
+		bool onReleasePath;       /* Already on the way to a capture, while working out the paths of a mouse up. */
+		
+	} m_internals;
+	
+protected:
+	
+	// These are protected so Widget classes can work with these internally.
+	// Modifying these will not call onMove/onResize, you must call these events manually when appropriate.
+	T x, y, width, height;
+	
+public:
+	
+	/* *** Contruction/Deconstruction *** */
+	
+	BasicWidget()
+	{
+		x = T(0); y = T(0);
+		width = T(0); height = T(0);
+		
+		m_internals.parent = NULL;
+		m_internals.hover = NULL;
+		m_internals.moveTarget = NULL;
+		
+		m_internals.index = NULL;
+		m_internals.slot = 0;
+		m_internals.zorder = 0;
+		m_internals.zcounter = 0;
+		
+		m_internals.dispatch = DISPATCH_BROADCAST;
+		m_internals.keySnoop = false;
+		m_internals.mouseTrack = false;
+		m_internals.pressWatch = false;
+		for (int i = 0; i < NUM_SUBTREE_COUNTERS; ++i)
+			m_internals.counts[i] = 0;
+		m_internals.counts[COUNT_AWAKE] = 1;
+		
+		m_internals.sleeping = false;
+		m_internals.wakePending = false;
+		m_internals.scheduled = false;
+		m_internals.wakeDelay = 0.;
+		m_internals.parallelUpdate = false;
+		
+#if defined(WIDGET_ENABLE_STATS)
+		m_internals.updateTime = 0.;
+		m_internals.drawTime = 0.;
+#endif
+		
+		m_internals.down = false;
+		m_internals.downBtn = 0;
+		m_internals.captured = false;
+		m_internals.onReleasePath = false;
+		m_internals.mouseInsideChild = false;
+		
+		m_internals.hidden = false;
+		m_internals.effHidden = false;
+		m_internals.effFocused = true;
+		m_internals.focusedChild = true;
+		m_internals.tree = NULL;
+		m_internals.pool = NULL;
+		m_internals.blockSize = 0;
+		m_internals.drawCtx = NULL;
+		m_internals.clipChildren = false;
+		m_internals.childExtentValid = false;
+		m_internals.mouseX = T(0);
+		m_internals.mouseY = T(0);
+		m_internals.moveStamp = 0;
+		m_internals.mouseCurrent = true;
+		m_internals.hoverDirty = true;
+	}
+	
+	
+	// Children made with create() are destroyed along with their parent. Other children are detached.
+	virtual ~BasicWidget()
+	{
+		if (m_internals.parent)
+			m_internals.parent->removeWidget(this);
+		
+		// Too late to call our events, we are no longer the derived widget.
+		this->destroyChildren(false);
+		
+		delete m_internals.index;
+		delete m_internals.tree;
+	}
+	
+	
+	/* *** Transformation *** */
+	
+	void move(T movex, T movey)
+	{
+		this->invalidate();
+		
+		x += movex;
+		y += movey;
+		
+		this->refreshBounds();
+		this->invalidate();
+		this->onMove(movex, movey);
+	}
+	
+	void setPosition(T posx, T posy)
+	{
+		T oldx = x, oldy = y;
+		
+		this->invalidate();
+		
+		x = posx;
+		y = posy;
+		
+		this->refreshBounds();
+		this->invalidate();
+		this->onMove(x - oldx, y - oldy);
+	}
+	
+	inline void getPosition(T& out_x, T& out_y) const
+	{
+		out_x = x;
+		out_y = y; 
+	}
+	
+	inline T getPositionX() const
+	{
+		return x;
+	}
+	
+	inline T getPositionY() const
+	{
+		return y;
+	}
+	
+	
+	void setSize(T sizewidth, T sizeheight)
+	{
+		this->invalidate();
+		
+		width = sizewidth;
+		height = sizeheight;
+		
+		this->refreshBounds();
+		this->invalidate();
+		this->onResize();
+		
+		if (m_internals.parent)
+			m_internals.parent->onChildResize(*this);
+	}
+	
+	inline void getSize(T& out_width, T& out_height) const
+	{
+		out_width = width;
+		out_height = height;
+	}
+	
+	inline T getWidth() const
+	{
+		return width;
+	}
+	
+	inline T getHeight() const
+	{
+		return height;
+	}
+	
+	// Let the parent know this widget's bounds have changed.
+	// Call this after modifying x/y/width/height directly, else hit-testing in the parent may use stale bounds.
+	void refreshBounds()
+	{
+		this->geometryChanged();
+		this->extentChanged();
+		
+		BasicWidget* parent = m_internals.parent;
+		
+		if (!parent)
+			return;
+		
+		// The parent is shared with the other parallel subtrees, so updateParallel() does this after the join.
+		UpdatePass* pass = currentPass();
+		if (pass && pass->top == this)
+		{
+			pass->boundsChanged = true;
+			return;
+		}
+		
+		if (parent->m_internals.index)
+			parent->m_internals.index->update(this);
+		
+		parent->m_internals.widgets.updateBounds(this);
+		
+		// The parent may no longer be hovering the same child.
+		parent->m_internals.hoverDirty = true;
+	}
+	
+	
+	/* *** Visibility *** */
+	
+	// Check if we're hidden or if our parents are hidden.
+	bool isHidden() const
+	{
+		return m_internals.effHidden;
+	}
+	
+	// Hide this widget and children.
+	void hide(bool hidden = true)
+	{
+		if (m_internals.hidden == hidden)
+			return;
+		
+		// Damage is only recorded for visible widgets, so invalidate while visible.
+		if (hidden)
+			this->invalidate();
+		
+		m_internals.hidden = hidden;
+		this->refreshHidden();
+		this->geometryChanged();
+		this->extentChanged();
+		
+		if (!hidden)
+			this->invalidate();
+	}
+	
+	
+	/* *** Damage tracking *** */
+	
+	// Enable or disable damage tracking. Only has an effect on the root widget of a tree.
+	// When enabled, draw() only redraws children touching an invalidated area, and passes a DrawContext as `udata' to onDraw.
+	void setDamageTracking(bool enabled)
+	{
+		if (!enabled && !m_internals.tree)
+			return;
+		
+		TreeState& tree = this->getTreeState();
+		tree.trackDamage = enabled;
+		tree.damage.clear();
+		
+		// Everything has to be drawn once.
+		tree.fullDamage = enabled;
+	}
+	
+	// Is damage tracking enabled?
+	bool isDamageTracking() const
+	{
+		return m_internals.tree && m_internals.tree->trackDamage;
+	}
+	
+	// Mark this widget (and its children) as needing to be redrawn.
+	// Geometry, visibility and structural changes do this automatically, call it when the widget's appearance changes.
+	void invalidate()
+	{
+		if (!m_internals.parent)
+		{
+			this->invalidateAll();
+			return;
+		}
+		
+		// Without damage tracking, the tree only has to know it changed. Nothing needs the area.
+		if (!this->getRoot()->isDamageTracking())
+		{
+			this->invalidateRect(T(0), T(0), T(0), T(0));
+			return;
+		}
+		
+		// Children can be drawn outside of this widget, unless it clips them.
+		Rect extent(T(0), T(0), width, height);
+		extent.add(this->getChildExtent());
+		
+		this->invalidateRect(extent.x, extent.y, extent.width, extent.height);
+	}
+	
+	// Mark an area (relative to this widget) as needing to be redrawn.
+	void invalidateRect(T rx, T ry, T rwidth, T rheight)
+	{
+		// Empty rectangles still go all the way up: nothing needs redrawing, but the tree changed. (See drawList().)
+		Rect rect(rx, ry, rwidth, rheight);
+		
+		// Move the rectangle into screen coordinates, on the way up to the root.
+		BasicWidget* cur = this;
+		
+		for (;;)
+		{
+			// Hidden widgets can't be seen, so there is nothing to redraw.
+			if (cur->m_internals.hidden)
+				return;
+			
+			rect.x += cur->x;
+			rect.y += cur->y;
+			
+			if (!cur->m_internals.parent)
+				break;
+			
+			cur = cur->m_internals.parent;
+		}
+		
+		// Parallel updates hand their damage over after the join.
+		UpdatePass* pass = currentPass();
+		if (pass && pass->top)
+		{
+			pass->damage.push_back(rect);
+			return;
+		}
+		
+		cur->invalidateScreenRect(rect);
+	}
+	
+	// Mark the whole tree as needing to be redrawn.
+	void invalidateAll()
+	{
+		UpdatePass* pass = currentPass();
+		if (pass && pass->top)
+		{
+			pass->damageAll = true;
+			return;
+		}
+		
+		BasicWidget* root = this;
+		while (root->m_internals.parent)
+			root = root->m_internals.parent;
+		
+		if (!root->m_internals.tree)
+			return;
+		
+		++root->m_internals.tree->changes;
+		
+		if (!root->isDamageTracking())
+			return;
+		
+		root->m_internals.tree->fullDamage = true;
+		root->m_internals.tree->damage.clear();
+	}
+	
+	// Does anything need to be redrawn? Always true without damage tracking.
+	bool hasDamage() const
+	{
+		if (!this->isDamageTracking())
+			return true;
+		
+		return m_internals.tree->fullDamage || !m_internals.tree->damage.empty();
+	}
+	
+	// Get the merged damage rectangles (in screen coordinates) waiting to be redrawn.
+	// Empty if everything needs to be redrawn, or if damage tracking is disabled.
+	const std::vector<Rect>& getDamage() const
+	{
+		static const std::vector<Rect> none;
+		
+		if (!m_internals.tree)
+			return none;
+		
+		return m_internals.tree->damage;
+	}
+	
+	
+	/* *** Clipping *** */
+	
+	// Clip this widget's children to its bounds. Children (and their subtrees) entirely outside of it are not drawn.
+	// This expects widgets to draw within their own bounds.
+	void setClipChildren(bool clip = true)
+	{
+		if (m_internals.clipChildren == clip)
+			return;
+		
+		m_internals.clipChildren = clip;
+		m_internals.childExtentValid = false;
+		this->extentChanged();
+		this->invalidate();
+	}
+	
+	// Are this widget's children clipped to its bounds?
+	bool isClipChildren() const
+	{
+		return m_internals.clipChildren;
+	}
+	
+	// Set the area (in screen coordinates) the tree is drawn into, usually the window. Only has an effect on the root widget of a tree.
+	// Widgets entirely outside of the viewport are not drawn.
+	void setViewport(T vx, T vy, T vwidth, T vheight)
+	{
+		TreeState& tree = this->getTreeState();
+		tree.hasViewport = true;
+		tree.viewport = Rect(vx, vy, vwidth, vheight);
+		
+		this->invalidateAll();
+	}
+	
+	// Stop culling widgets outside of the viewport.
+	void clearViewport()
+	{
+		if (!this->hasViewport())
+			return;
+		
+		m_internals.tree->hasViewport = false;
+		this->invalidateAll();
+	}
+	
+	// Has a viewport been set?
+	bool hasViewport() const
+	{
+		return m_internals.tree && m_internals.tree->hasViewport;
+	}
+	
+	// Get the area (in screen coordinates) this widget is clipped to while it is being drawn.
+	// Returns false if nothing clips it, or if it isn't being drawn.
+	bool getClipRect(Rect& out_clip) const
+	{
+		if (!m_internals.drawCtx || !m_internals.drawCtx->clipped)
+			return false;
+		
+		out_clip = m_internals.drawCtx->clip;
+		return true;
+	}
+	
+	
+	/* *** Modify children *** */
+	
+	// Add a child widget to this widget.
+	void addWidget(BasicWidget* widget)
+	{
+		// Push the new child to the back. (It will become the focused widget)
+		BasicWidget* oldFocus = this->getFocused();
+		m_internals.widgets.push_back(widget);
+		widget->m_internals.parent = this;
+		this->raiseZOrder(widget);
+		this->focusMoved(oldFocus, widget);
+		widget->refreshHidden();
+		
+		if (m_internals.index)
+			m_internals.index->insert(widget);
+		
+		// The child joins this tree's dispatch mode.
+		if (widget->m_internals.dispatch != m_internals.dispatch)
+			widget->setDispatchFlags(m_internals.dispatch);
+		
+		for (int c = 0; c < NUM_SUBTREE_COUNTERS; ++c)
+		{
+			if (widget->m_internals.counts[c])
+				this->adjustCount(c, static_cast<int>(widget->m_internals.counts[c]));
+		}
+		
+		this->takeCaptures(widget);
+		this->forgetChildExtent();
+		widget->invalidate();
+		
+		// Call widget Adopt events.
+		this->onAdopt(*widget);
+		widget->onAdopted(*this);
+	}
+	
+	// Add several child widgets at once, in order. Same as calling addWidget() for each of them, but the child list only grows
+	// once, and the subtree counters of this widget and its parents are only adjusted once.
+	// Without `notify', Adopt/Adopted events are skipped, and left for the caller to send. (See BulkBuilder.)
+	void addWidgets(BasicWidget* const* widgets, size_t count, bool notify = true)
+	{
+		if (!count)
+			return;
+		
+		BasicWidget* oldFocus = this->getFocused();
+		unsigned int totals[NUM_SUBTREE_COUNTERS] = { 0 };
+		
+		// Only trees with state keep track of invalidated areas.
+		bool invalidate = this->getRoot()->m_internals.tree != NULL;
+		
+		m_internals.widgets.reserve(m_internals.widgets.size() + count);
+		this->forgetChildExtent();
+		
+		if (m_internals.zcounter > UINT_MAX - count)
+			this->renumberZOrder();
+		
+		for (size_t i = 0; i < count; ++i)
+		{
+			BasicWidget* widget = widgets[i];
+			
+			m_internals.widgets.push_back(widget);
+			widget->m_internals.parent = this;
+			widget->m_internals.zorder = ++m_internals.zcounter;
+			this->focusMoved(oldFocus, widget);
+			widget->refreshHidden();
+			oldFocus = widget;
+			
+			if (m_internals.index)
+				m_internals.index->insert(widget);
+			
+			if (widget->m_internals.dispatch != m_internals.dispatch)
+				widget->setDispatchFlags(m_internals.dispatch);
+			
+			for (int c = 0; c < NUM_SUBTREE_COUNTERS; ++c)
+				totals[c] += widget->m_internals.counts[c];
+			
+			this->takeCaptures(widget);
+			
+			if (invalidate)
+				widget->invalidate();
+		}
+		
+		for (int c = 0; c < NUM_SUBTREE_COUNTERS; ++c)
+		{
+			if (totals[c])
+				this->adjustCount(c, static_cast<int>(totals[c]));
+		}
+		
+		// One of the new children may now be the one under the mouse.
+		m_internals.hoverDirty = true;
+		this->geometryChanged();
+		
+		if (!notify)
+			return;
+		
+		for (size_t i = 0; i < count; ++i)
+		{
+			this->onAdopt(*widgets[i]);
+			widgets[i]->onAdopted(*this);
+		}
+	}
+	
+	// Remove a child widget from this widget.
+	bool removeWidget(BasicWidget* widget)
+	{
+		BasicWidget* child = widget;
+		
+		if (!this->hasWidget(*child))
+			return false;
+		
+		child->invalidate();
+		child->dropCaptures(true);
+		
+		// Remove it from children.
+		child->m_internals.parent = NULL;
+		m_internals.widgets.erase(child);
+		this->forgetChildExtent();
+		
+		// The child becomes a root, so it is focused. If it was our focused child, the next one takes over.
+		if (!child->m_internals.focusedChild)
+			child->m_internals.focusedChild = true;
+		else
+			this->focusMoved(NULL, this->getFocused());
+		
+		child->setFocusChain(true);
+		child->refreshHidden();
+		child->geometryChanged();
+		
+		if (m_internals.index)
+			m_internals.index->remove(child);
+		
+		if (m_internals.moveTarget == child)
+			m_internals.moveTarget = NULL;
+		
+		// The mouse may have been over the child.
+		m_internals.hoverDirty = true;
+		this->geometryChanged();
+		
+		for (int c = 0; c < NUM_SUBTREE_COUNTERS; ++c)
+		{
+			if (child->m_internals.counts[c])
+				this->adjustCount(c, -static_cast<int>(child->m_internals.counts[c]));
+		}
+		
+		// Call widget Disown events.
+		this->onDisown(*child);
+		child->onDisowned(*this);
+		
+		return true;
+	}
+	
+	// Check if this widget parents a specific child widget.
+	bool hasWidget(const BasicWidget& widget) const
+	{
+		return widget.m_internals.parent == this;
+	}
+	
+	// Construct a widget of type W and add it as a child. The widget is owned by the tree, and allocated from the tree's pool.
+	// Owned widgets are destroyed along with their parent, or with destroyWidget(). Never delete them yourself.
+	template <typename W, typename... Args>
+	W* create(Args&&... args)
+	{
+		static_assert(alignof(W) <= WidgetPool::GRANULARITY, "Widget type is over-aligned for the widget pool.");
+		
+		TreeState& tree = this->getRoot()->getTreeState();
+		if (!tree.pool)
+			tree.pool = new WidgetPool();
+		
+		W* widget = new (tree.pool->allocate(sizeof(W))) W(std::forward<Args>(args)...);
+		
+		BasicWidget* owned = widget;
+		owned->m_internals.pool = tree.pool;
+		owned->m_internals.blockSize = static_cast<unsigned int>(sizeof(W));
+		
+		this->addWidget(owned);
+		
+		return widget;
+	}
+	
+	// Was this widget made with create()?
+	bool isOwned() const
+	{
+		return m_internals.pool != NULL;
+	}
+	
+	// Remove a child made with create(), and destroy it along with its children.
+	// Returns false (and does nothing) if the widget isn't an owned child of this widget.
+	bool destroyWidget(BasicWidget* widget)
+	{
+		if (!this->hasWidget(*widget) || !widget->isOwned())
+			return false;
+		
+		widget->destroyChildren(true);
+		this->removeWidget(widget);
+		freeOwned(widget);
+		
+		return true;
+	}
+	
+	// Remove all children, destroying the ones made with create(). Other children are detached and left to their owner.
+	// Without `notify', Disown/Disowned events are skipped and the whole subtree is torn down in one pass,
+	// without fixing up focus or hover one child at a time.
+	void destroyChildren(bool notify = true)
+	{
+		BasicWidget* child;
+		
+		if (m_internals.widgets.empty())
+			return;
+		
+		if (notify)
+		{
+			// Remove children one by one from the back, so events see a consistent tree.
+			while (!m_internals.widgets.empty())
+			{
+				child = m_internals.widgets.back();
+				
+				if (child->isOwned())
+					this->destroyWidget(child);
+				else
+					this->removeWidget(child);
+			}
+			
+			return;
+		}
+		
+		this->invalidate();
+		this->dropCaptures(false);
+		
+		// Take the children's counts out of ours (and our parents') in one go.
+		for (int c = 0; c < NUM_SUBTREE_COUNTERS; ++c)
+		{
+			unsigned int total = 0;
+			
+			for (size_t i = 0, sz = m_internals.widgets.size(); i < sz; ++i)
+			{
+				if ((child = m_internals.widgets[i]))
+					total += child->m_internals.counts[c];
+			}
+			
+			if (total)
+				this->adjustCount(c, -static_cast<int>(total));
+		}
+		
+		for (size_t i = m_internals.widgets.size(); i--;)
+		{
+			if (!(child = m_internals.widgets[i]))
+				continue;
+			
+			child->m_internals.parent = NULL;
+			
+			if (child->isOwned())
+			{
+				freeOwned(child);
+			}
+			else
+			{
+				// The child becomes a root.
+				child->m_internals.focusedChild = true;
+				child->setFocusChain(true);
+				child->refreshHidden();
+				child->geometryChanged();
+			}
+		}
+		
+		m_internals.widgets.clear();
+		
+		if (m_internals.index)
+			m_internals.index->clear();
+		
+		m_internals.hover = NULL;
+		m_internals.moveTarget = NULL;
+		m_internals.hoverDirty = true;
+		m_internals.zcounter = 0;
+		this->geometryChanged();
+		this->forgetChildExtent();
+	}
+	
+	
+	// Enable or disable the spatial index over this widget's children.
+	// Worth enabling on containers with many children; hit-tests then only look at children near the mouse.
+	void setSpatialIndex(bool enabled, T cellSize = T(64))
+	{
+		delete m_internals.index;
+		m_internals.index = NULL;
+		
+		if (!enabled)
+			return;
+		
+		m_internals.index = new ChildIndex(cellSize);
+		
+		for (size_t i = 0, sz = m_internals.widgets.size(); i < sz; ++i)
+		{
+			if (m_internals.widgets[i])
+				m_internals.index->insert(m_internals.widgets[i]);
+		}
+	}
+	
+	// Is the spatial index enabled for this widget's children?
+	bool hasSpatialIndex() const
+	{
+		return m_internals.index != NULL;
+	}
+	
+	// Keep a packed copy of the children's bounds, so hit-tests can test several children at once (using SIMD when available.)
+	// Cheaper to keep up to date than the spatial index, but hit-tests still look at every child.
+	void setPackedBounds(bool enabled)
+	{
+		m_internals.widgets.setPacked(enabled);
+	}
+	
+	// Does this widget keep a packed copy of its children's bounds?
+	bool hasPackedBounds() const
+	{
+		return m_internals.widgets.getBounds() != NULL;
+	}
+	
+	
+	/* *** Screen position *** */
+	
+	// Get this widget's position on the screen. (Relative to the same origin as the root's position.)
+	// Worked out on the way up to the root. Nothing is cached, so it is safe to call from parallel updates.
+	void getAbsolutePosition(T& out_x, T& out_y) const
+	{
+		out_x = T(0);
+		out_y = T(0);
+		
+		for (const BasicWidget* cur = this; cur; cur = cur->m_internals.parent)
+		{
+			out_x += cur->x;
+			out_y += cur->y;
+		}
+	}
+	
+	T getAbsoluteX() const
+	{
+		T ax, ay;
+		this->getAbsolutePosition(ax, ay);
+		return ax;
+	}
+	
+	T getAbsoluteY() const
+	{
+		T ax, ay;
+		this->getAbsolutePosition(ax, ay);
+		return ay;
+	}
+	
+	// Get this widget's bounds on the screen.
+	Rect getAbsoluteBounds() const
+	{
+		Rect bounds(T(0), T(0), width, height);
+		this->getAbsolutePosition(bounds.x, bounds.y);
+		return bounds;
+	}
+	
+	// Get the top-most visible widget at a point on the screen, searching the whole tree. NULL if the point is outside of the root.
+	// Like mouse presses, a widget is only hit inside of all its parents.
+	// Queries share an index over the tree. While the tree keeps changing between queries (say, while dragging) they walk down
+	// the tree instead, the index is only built again once a query finds the tree unchanged since the last one.
+	BasicWidget* widgetAt(T sx, T sy)
+	{
+		BasicWidget* root = this->getRoot();
+		
+		if (ScreenIndex* index = root->getScreenIndex())
+			return index->hitTest(sx, sy);
+		
+		if (root->m_internals.hidden)
+			return NULL;
+		
+		// Walk down through the top-most child under the point.
+		T x = sx - root->x, y = sy - root->y;
+		
+		if (!(x >= T(0) && x < root->width && y >= T(0) && y < root->height))
+			return NULL;
+		
+		BasicWidget* hit = root;
+		
+		while (BasicWidget* child = hit->findChildAt(x, y, true))
+		{
+			x -= child->x;
+			y -= child->y;
+			hit = child;
+		}
+		
+		return hit;
+	}
+	
+	// Find every visible widget of the tree overlapping a rectangle on the screen (within its parents), in drawing order.
+	// The widgets are added to `out_widgets'. Returns the number found. Uses the same index as widgetAt().
+	size_t widgetsInRect(const Rect& rect, std::vector<BasicWidget*>& out_widgets)
+	{
+		BasicWidget* root = this->getRoot();
+		size_t count = out_widgets.size();
+		
+		if (ScreenIndex* index = root->getScreenIndex())
+		{
+			index->query(rect, out_widgets);
+		}
+		else if (!root->m_internals.hidden)
+		{
+			Rect bounds(root->x, root->y, root->width, root->height);
+			
+			if (!bounds.isEmpty())
+				root->findInRect(rect, root->x, root->y, bounds, out_widgets);
+		}
+		
+		return out_widgets.size() - count;
+	}
+	
+	
+	/* *** Widget parent *** */
+	
+	// Does this widget have a parent?
+	bool hasParent() const
+	{
+		return m_internals.parent != NULL;
+	}
+	
+	// Returns the root of this widget's tree. Returns itself if it has no parent.
+	BasicWidget* getRoot()
+	{
+		BasicWidget* root = this;
+		
+		while (root->m_internals.parent)
+			root = root->m_internals.parent;
+		
+		return root;
+	}
+	
+	// Returns the root of this widget's tree. Returns itself if it has no parent.
+	const BasicWidget* getRoot() const
+	{
+		const BasicWidget* root = this;
+		
+		while (root->m_internals.parent)
+			root = root->m_internals.parent;
+		
+		return root;
+	}
+	
+	// Returns the parent widget. Returns NULL if no parent.
+	BasicWidget* getParent()
+	{
+		return m_internals.parent;
+	}
+	
+	// Returns the parent widget. Returns NULL if no parent.
+	const BasicWidget* getParent() const
+	{
+		return m_internals.parent;
+	}
+	
+	
+	/* *** Widget children *** */
+	
+	// Does this widget contain children widgets?
+	bool hasChildren() const
+	{
+		return !m_internals.widgets.empty();
+	}
+	
+	// Get a child as specific index. Index must valid (in bounds).
+	BasicWidget* getChild(size_t idx)
+	{
+		return m_internals.widgets.at(idx);
+	}
+	
+	// Get a child as specific index. Index must valid (in bounds).
+	const BasicWidget* getChild(size_t idx) const
+	{
+		return m_internals.widgets.at(idx);
+	}
+	
+	// Get the number of children this widget parents.
+	size_t getNumOfChildren() const
+	{
+		return m_internals.widgets.count();
+	}
+	
+	// Get the top-most visible child under [x, y] (relative to this widget.) Returns NULL if there is none.
+	BasicWidget* getChildAt(T x, T y)
+	{
+		return this->findChildAt(x, y, true);
+	}
+	
+	// Get the top-most visible child under [x, y] (relative to this widget.) Returns NULL if there is none.
+	const BasicWidget* getChildAt(T x, T y) const
+	{
+		return this->findChildAt(x, y, true);
+	}
+	
+	
+	/* *** Widget focus *** */
+	
+	// Force child at index to be the focused widget. This function does nothing if index is not valid (not in bounds).
+	void setFocus(size_t idx)
+	{
+		if (idx >= m_internals.widgets.count())
+			return;
+		
+		this->setFocus(m_internals.widgets.at(idx));
+	}
+	
+	// Force child to be the focused widget. The child must be a child of this widget, else this function does nothing.
+	void setFocus(const BasicWidget* child)
+	{
+		if (!child || child->m_internals.parent != this)
+			return;
+		
+		BasicWidget* widget = m_internals.widgets[child->m_internals.slot];
+		
+		// Don't do anything if widget is already focused.
+		if (widget->isFocusedChild())
+			return;
+		
+		// Make it the focused object.
+		BasicWidget* oldFocus = m_internals.widgets.back();
+		m_internals.widgets.raise(widget);
+		this->raiseZOrder(widget);
+		this->focusMoved(oldFocus, widget);
+		widget->invalidate();
+		
+		// Call lost/gained focus events.
+		oldFocus->onFocusLost();
+		widget->onFocusGained();
+	}
+	
+	// Get the focused child. Returns NULL if no children are present.
+	BasicWidget* getFocused()
+	{
+		// Return NULL if empty.
+		if (m_internals.widgets.empty())
+			return NULL;
+		
+		// The back widget is the focused component.
+		return m_internals.widgets.back();
+	}
+	
+	// Get the focused child. Returns NULL if no children are present.
+	const BasicWidget* getFocused() const
+	{
+		// Return NULL if empty.
+		if (m_internals.widgets.empty())
+			return NULL;
+		
+		// The back widget is the focused component.
+		return m_internals.widgets.back();
+	}
+	
+	// Is this widget the focused widget of the parent, and the parent of its parent, and so on? Always returns true if no parent is present.
+	bool isFocused() const
+	{
+		return m_internals.effFocused;
+	}
+	
+	// Is this widget the focused widget of the parent? Always returns true if no parent is present.
+	bool isFocusedChild() const
+	{
+		return m_internals.focusedChild;
+	}
+	
+	// Try to pop this widget out of focus and make the next sibling widget in focus instead.
+	void popFocus()
+	{
+		// This should be the focused child.
+		if (!this->isFocusedChild())
+			return;
+		
+		// Can't pop if there is no parent.
+		if (!m_internals.parent)
+			return;
+		
+		// Can't pop if this is the only child.
+		if (m_internals.parent->m_internals.widgets.count() < 2)
+			return;
+		
+		// Set the second child into focus.
+		m_internals.parent->setFocus(m_internals.parent->m_internals.widgets.previous(this));
+	}
+	
+	
+	/* *** Mouse interactivity *** */
+	
+	// Is the mouse holding this widget? Optionally, it will return which mouse button is holding the widget down via `btn'.
+	bool isHeldDown(unsigned int* btn = NULL) const
+	{
+		if (m_internals.down)
+		{
+			*btn = m_internals.downBtn;
+			return true;
+		}
+		return false;
+	}
+	
+	// Is the mouse hovering over this widget?
+	bool isMouseHovering() const
+	{
+		// Check if the hovering component is this widget.
+		if (m_internals.parent)
+			return m_internals.parent->m_internals.hover == this;
+		
+		// Always return false if no m_internals.parent.
+		return false;
+	}
+	
+	// Get the relative mouse position.
+	T getRelativeMouseX() const
+	{
+		T mx, my;
+		this->getRelatieMousePos(mx, my);
+		return mx;
+	}
+	
+	// Get the relative mouse position.
+	T getRelativeMouseY() const
+	{
+		T mx, my;
+		this->getRelatieMousePos(mx, my);
+		return my;
+	}
+	
+	// Get relative mouse position.
+	void getRelatieMousePos(T& x, T& y) const
+	{
+		x = m_internals.mouseX;
+		y = m_internals.mouseY;
+		
+		if (!(m_internals.dispatch & DISPATCH_CULLED_MOUSE_MOVE) || !m_internals.parent)
+			return;
+		
+		// Mouse moves may have been culled before reaching this widget.
+		// Work it out from the closest parent that received the latest mouse move instead.
+		const BasicWidget* top = this;
+		while (top->m_internals.parent)
+			top = top->m_internals.parent;
+		
+		const BasicWidget* cur = this;
+		T offx = T(0), offy = T(0);
+		
+		while (cur->m_internals.moveStamp != top->m_internals.moveStamp)
+		{
+			offx += cur->x;
+			offy += cur->y;
+			cur = cur->m_internals.parent;
+		}
+		
+		x = cur->m_internals.mouseX - offx;
+		y = cur->m_internals.mouseY - offy;
+	}
+	
+	
+	/* *** Event dispatch *** */
+	
+	// Controls how events are passed down the widget tree. Flags may be combined.
+	enum DispatchFlags
+	{
+		// Every event is sent to every child. (Default)
+		DISPATCH_BROADCAST = 0,
+		
+		// Key events only travel down the focus chain, plus to widgets that snoop keys. (See setKeySnooping.)
+		DISPATCH_FOCUSED_KEYS = 1 << 0,
+		
+		// Mouse moves only go to the child under the mouse, children held down, and widgets tracking the mouse. (See setMouseTracking.)
+		DISPATCH_CULLED_MOUSE_MOVE = 1 << 1,
+		
+		// Mouse ups only travel down the paths to the widgets held down by that button, and to widgets that captured the pointer.
+		// The paths are remembered when the buttons are pressed. (See capturePointer.)
+		DISPATCH_CAPTURED_MOUSE_UP = 1 << 2,
+		
+		// Mouse downs only go to the child under the mouse, found like getChildAt(), and widgets watching every press. (See setPressWatching.)
+		DISPATCH_CULLED_MOUSE_DOWN = 1 << 3
+	};
+	
+	// Set the dispatch flags of this widget and all its children.
+	// Children adopted later take on the flags of their new parent.
+	void setDispatchFlags(unsigned int flags)
+	{
+		m_internals.dispatch = flags;
+		m_internals.hoverDirty = true;
+		
+		for (size_t i = 0, sz = m_internals.widgets.size(); i < sz; ++i)
+		{
+			if (m_internals.widgets[i])
+				m_internals.widgets[i]->setDispatchFlags(flags);
+		}
+	}
+	
+	// Get the dispatch flags for this widget.
+	unsigned int getDispatchFlags() const
+	{
+		return m_internals.dispatch;
+	}
+	
+	// Receive key events even when this widget isn't on the focus chain.
+	// Only meaningful with DISPATCH_FOCUSED_KEYS, every widget receives key events otherwise.
+	void setKeySnooping(bool snoop = true)
+	{
+		if (m_internals.keySnoop == snoop)
+			return;
+		
+		m_internals.keySnoop = snoop;
+		this->adjustCount(COUNT_KEY_SNOOPERS, snoop ? 1 : -1);
+	}
+	
+	// Does this widget receive key events when it isn't on the focus chain?
+	bool isKeySnooping() const
+	{
+		return m_internals.keySnoop;
+	}
+	
+	// Receive every mouse move, even when the mouse is outside this widget.
+	// Only meaningful with DISPATCH_CULLED_MOUSE_MOVE, every widget receives mouse moves otherwise.
+	void setMouseTracking(bool track = true)
+	{
+		if (m_internals.mouseTrack == track)
+			return;
+		
+		m_internals.mouseTrack = track;
+		this->adjustCount(COUNT_MOUSE_TRACKERS, track ? 1 : -1);
+	}
+	
+	// Does this widget receive mouse moves when the mouse is outside of it?
+	bool isMouseTracking() const
+	{
+		return m_internals.mouseTrack;
+	}
+	
+	// Receive every mouse down, even when the mouse is outside this widget. Useful for popups that close on a click elsewhere.
+	// Only meaningful with DISPATCH_CULLED_MOUSE_DOWN, every widget receives mouse downs otherwise.
+	void setPressWatching(bool watch = true)
+	{
+		if (m_internals.pressWatch == watch)
+			return;
+		
+		m_internals.pressWatch = watch;
+		this->adjustCount(COUNT_PRESS_WATCHERS, watch ? 1 : -1);
+	}
+	
+	// Does this widget receive mouse downs when the mouse is outside of it?
+	bool isPressWatching() const
+	{
+		return m_internals.pressWatch;
+	}
+	
+	// Capture the pointer: receive every mouse move and mouse up, even when the mouse is outside this widget, until releasePointer().
+	// Useful for drag handles. The capture also ends when the widget leaves its tree.
+	void capturePointer()
+	{
+		if (m_internals.captured)
+			return;
+		
+		m_internals.captured = true;
+		this->adjustCount(COUNT_CAPTURING, 1);
+		
+		Capture capture;
+		capture.widget = this;
+		capture.button = 0;
+		capture.pointer = true;
+		
+		this->getRoot()->getTreeState().captures.push_back(capture);
+	}
+	
+	// End a capture started with capturePointer().
+	void releasePointer()
+	{
+		if (!m_internals.captured)
+			return;
+		
+		TreeState* tree = this->getRoot()->m_internals.tree;
+		
+		for (size_t i = tree ? tree->captures.size() : 0; i--;)
+		{
+			if (tree->captures[i].widget == this && tree->captures[i].pointer)
+			{
+				tree->captures.erase(tree->captures.begin() + i);
+				break;
+			}
+		}
+		
+		m_internals.captured = false;
+		this->adjustCount(COUNT_CAPTURING, -1);
+	}
+	
+	// Did this widget capture the pointer?
+	bool isPointerCaptured() const
+	{
+		return m_internals.captured;
+	}
+	
+	
+	/* *** Update scheduling *** */
+	
+	// Put this widget to sleep, so onUpdate() is only called when it is woken up by requestUpdate() or scheduleUpdate().
+	// Subtrees with nothing awake are skipped during update, apart from the widgets under the mouse (to keep hover up to date.)
+	// Children of a sleeping widget still update as usual.
+	void setSleeping(bool sleeping = true)
+	{
+		if (m_internals.sleeping == sleeping)
+			return;
+		
+		bool wasAwake = this->isAwake();
+		m_internals.sleeping = sleeping;
+		
+		if (this->isAwake() != wasAwake)
+			this->adjustCount(COUNT_AWAKE, wasAwake ? -1 : 1);
+	}
+	
+	// Is this widget only updated when woken up?
+	bool isSleeping() const
+	{
+		return m_internals.sleeping;
+	}
+	
+	// Have onUpdate() called on the next update, even if this widget is sleeping.
+	void requestUpdate()
+	{
+		if (m_internals.wakePending)
+			return;
+		
+		bool wasAwake = this->isAwake();
+		m_internals.wakePending = true;
+		
+		if (!wasAwake)
+			this->adjustCount(COUNT_AWAKE, 1);
+	}
+	
+	// Have onUpdate() called once `delay' seconds (as passed to update()) have gone by, even if this widget is sleeping.
+	// If an update is already scheduled, the earlier of the two is kept.
+	void scheduleUpdate(double delay)
+	{
+		if (delay <= 0.)
+		{
+			this->requestUpdate();
+			return;
+		}
+		
+		if (m_internals.scheduled)
+		{
+			if (delay < m_internals.wakeDelay)
+				m_internals.wakeDelay = delay;
+			
+			return;
+		}
+		
+		m_internals.scheduled = true;
+		m_internals.wakeDelay = delay;
+		this->adjustCount(COUNT_SCHEDULED, 1);
+	}
+	
+	// Is an update scheduled with scheduleUpdate()?
+	bool isUpdateScheduled() const
+	{
+		return m_internals.scheduled;
+	}
+	
+	// Set the executor used to update subtrees marked with setParallelUpdate() concurrently. NULL (the default) updates serially.
+	// Only has an effect on the root widget of a tree. The executor is not owned by the widget.
+	void setUpdateExecutor(UpdateExecutor* executor)
+	{
+		if (!executor && !m_internals.tree)
+			return;
+		
+		this->getTreeState().executor = executor;
+	}
+	
+	// Get the executor used for parallel updates. NULL if updates are serial.
+	UpdateExecutor* getUpdateExecutor() const
+	{
+		return m_internals.tree ? m_internals.tree->executor : NULL;
+	}
+	
+	// Declare this widget and its children safe to update on another thread, concurrently with its siblings.
+	// During a parallel update, the subtree's onUpdate() calls may only change the subtree itself: no creating, destroying,
+	// or moving widgets in or out of it, and no reading siblings that are updated in parallel. Changes to counters
+	// of the parents (requestUpdate, setKeySnooping, ...), the subtree's bounds in its parent and invalidated areas are applied
+	// after all siblings are done, in child order, so the result doesn't depend on scheduling.
+	// Hover is worked out on the calling thread before updating. Parallel subtrees inside a parallel subtree update serially.
+	void setParallelUpdate(bool parallel = true)
+	{
+		m_internals.parallelUpdate = parallel;
+	}
+	
+	// Can this widget be updated on another thread?
+	bool isParallelUpdate() const
+	{
+		return m_internals.parallelUpdate;
+	}
+	
+	
+	/* *** Invoke events *** */
+	
+	// Update this and child widgets.
+	// Queued input is processed first. (See processInput.)
+	void update(double dt)
+	{
+		WIDGET_STATS_EVENT(EVENT_UPDATE);
+		
+		if (m_internals.tree && m_internals.tree->listener)
+			m_internals.tree->listener->onUpdate(dt);
+		
+		if (m_internals.tree && !m_internals.tree->input.empty())
+			this->processInput();
+		
+		if (!m_internals.mouseCurrent)
+		{
+			m_internals.mouseCurrent = true;
+			m_internals.hoverDirty = true;
+		}
+		
+		if (!m_internals.tree || !m_internals.tree->executor || currentPass())
+		{
+			this->updateTree(dt);
+			return;
+		}
+		
+		// Work out hover for the whole tree first, so parallel subtrees don't have to.
+		UpdatePass pass;
+		pass.executor = m_internals.tree->executor;
+		
+		this->updateHover();
+		
+		currentPass() = &pass;
+		this->updateTree(dt);
+		currentPass() = NULL;
+	}
+	
+	// Render this and child widgets.
+	// With damage tracking, nothing is drawn unless something was invalidated since the last draw.
+	void draw(void* udata = NULL)
+	{
+		WIDGET_STATS_EVENT(EVENT_DRAW);
+		
+		DrawContext ctx;
+		ctx.udata = udata;
+		ctx.list = NULL;
+		ctx.damage = NULL;
+		ctx.numDamage = 0;
+		ctx.fullRedraw = true;
+		
+		// Without damage tracking, onDraw gets `udata' as it is. The context is only used for clipping.
+		if (!this->isDamageTracking())
+		{
+			this->drawRoot(ctx, udata);
+			return;
+		}
+		
+		TreeState& tree = *m_internals.tree;
+		
+		if (!tree.fullDamage && tree.damage.empty())
+			return;
+		
+		ctx.damage = tree.damage.empty() ? NULL : &tree.damage[0];
+		ctx.numDamage = tree.damage.size();
+		ctx.fullRedraw = tree.fullDamage;
+		
+		this->drawRoot(ctx, &ctx);
+		
+		tree.fullDamage = false;
+		tree.damage.clear();
+	}
+	
+	// Record this and child widgets into a display list, replacing its contents.
+	// onDraw receives a DrawContext as `udata', with `list' set. The damage list is left untouched.
+	void record(DisplayList& list, void* udata = NULL)
+	{
+		WIDGET_STATS_EVENT(EVENT_DRAW);
+		
+		unsigned long version = this->getTreeState().changes;
+		
+		list.clear();
+		
+		DrawContext ctx;
+		ctx.udata = udata;
+		ctx.list = &list;
+		ctx.damage = NULL;
+		ctx.numDamage = 0;
+		ctx.fullRedraw = true;
+		
+		this->drawRoot(ctx, &ctx);
+		
+		list.finish();
+		list.setSource(this, version);
+	}
+	
+	// Replay a display list recorded from this widget, recording it again first if anything was invalidated since.
+	// Returns true if the list had to be recorded again.
+	bool drawList(DisplayList& list, DisplayList::Backend& backend, void* udata = NULL)
+	{
+		bool rerecord = !list.isFrom(this, this->getTreeState().changes);
+		
+		if (rerecord)
+			this->record(list, udata);
+		
+		list.replay(backend, udata);
+		
+		return rerecord;
+	}
+	
+	// Call this to invoke Mouse-Down related events.
+	// Mouse positions [x, y] here must be relative to the position of the parent widget (if any.)
+	// ie. Use global/screen/window mouse positions if this is the root widget.
+	void mouseDown(T x, T y, unsigned int b)
+	{
+		WIDGET_STATS_EVENT(EVENT_MOUSE_DOWN);
+		this->notifyInput(InputEvent::MOUSE_DOWN, x, y, T(0), T(0), 0, b);
+		
+		if (m_internals.hidden)
+			return;
+		
+		// Remember the widgets being held down, for the mouse up.
+		TreeState*& captureTree = currentCaptureTree();
+		TreeState* oldCaptureTree = captureTree;
+		
+		if (m_internals.dispatch & DISPATCH_CAPTURED_MOUSE_UP)
+			captureTree = &this->getRoot()->getTreeState();
+		
+		PendingPress& pending = pendingPress();
+		bool wasActive = pending.active;
+		pending.active = true;
+		
+		this->onMouseDown(x, y, b);
+		
+		if (!m_internals.mouseInsideChild &&
+			x >= this->x && x < this->x + this->width &&
+			y >= this->y && y < this->y + this->height )
+		{
+			// This widget is being held down.
+			if (!m_internals.down)
+				this->setHeldDown(true, b);
+			
+			// Mouse pressed.
+			this->onPress(x - this->x,  y - this->y, b);
+		}
+		
+		pending.active = wasActive;
+		if (!wasActive)
+			flushPressed();
+		
+		captureTree = oldCaptureTree;
+	}
+	
+	// Call this to invoke Mouse-Up related events.
+	// Mouse positions [x, y] here must be relative to the position of the parent widget (if any.)
+	// ie. Use global/screen/window mouse positions if this is the root widget.
+	void mouseUp(T x, T y, unsigned int b)
+	{
+		WIDGET_STATS_EVENT(EVENT_MOUSE_UP);
+		this->notifyInput(InputEvent::MOUSE_UP, x, y, T(0), T(0), 0, b);
+		
+		if (m_internals.hidden)
+			return;
+		
+		PendingPress& pending = pendingPress();
+		bool wasActive = pending.active;
+		pending.active = true;
+		
+		if (m_internals.dispatch & DISPATCH_CAPTURED_MOUSE_UP)
+		{
+			TreeState& tree = this->getRoot()->getTreeState();
+			
+			this->findReleasePaths(tree, b);
+			
+			TreeState*& captureTree = currentCaptureTree();
+			TreeState* oldCaptureTree = captureTree;
+			captureTree = &tree;
+			
+			this->onMouseUp(x, y, b);
+			
+			captureTree = oldCaptureTree;
+			
+			// Forget the widgets released by this button.
+			std::vector<Capture>& captures = tree.captures;
+			size_t kept = 0;
+			
+			for (size_t i = 0, sz = captures.size(); i < sz; ++i)
+			{
+				if (captures[i].pointer || captures[i].widget->m_internals.down)
+					captures[kept++] = captures[i];
+			}
+			
+			captures.resize(kept);
+		}
+		else
+		{
+			this->onMouseUp(x, y, b);
+		}
+		
+		bool released = m_internals.down && m_internals.downBtn == b;
+		
+		// No longer held down.
+		if (released)
+			this->setHeldDown(false, b);
+		
+		pending.active = wasActive;
+		if (!wasActive)
+			flushPressed();
+		
+		if (released)
+		{
+			// Mouse released this widget.
+			this->onRelease(x - this->x, y - this->y, b);
+			
+			if (m_internals.mouseInsideChild)
+				return;
+			
+			// Check if mouse was inside.
+			if (x >= this->x && x < this->x + this->width &&
+				y >= this->y && y < this->y + this->height )
+			{
+				// Widget was clicked.
+				this->onClick(x - this->x, y - this->y, b);
+			}
+		}
+	}
+	
+	// Call this to invoke Mouse-Wheel related events.
+	// Mouse positions [x, y] here must be relative to the position of the parent widget (if any.)
+	// ie. Use global/screen/window mouse positions if this is the root widget.
+	void mouseWheel(T x, T y, int d)
+	{
+		WIDGET_STATS_EVENT(EVENT_MOUSE_WHEEL);
+		this->notifyInput(InputEvent::MOUSE_WHEEL, x, y, T(0), T(0), d, 0);
+		this->onMouseWheel(x, y, d);
+	}
+	
+	// Call this to invoke Mouse-Move related events.
+	// Mouse positions [x, y] here must be relative to the position of the parent widget (if any.)
+	// ie. Use global/screen/window mouse positions if this is the root widget.
+	void mouseMove(T x, T y, T dx, T dy)
+	{
+		WIDGET_STATS_EVENT(EVENT_MOUSE_MOVE);
+		this->notifyInput(InputEvent::MOUSE_MOVE, x, y, dx, dy, 0, 0);
+		++m_internals.moveStamp;
+		flushPressed();
+		this->onMouseMove(x, y, dx, dy);
+	}
+	
+	
+	// Call this to invoke Key-Down related events.
+	void keyDown(int key)
+	{
+		WIDGET_STATS_EVENT(EVENT_KEY_DOWN);
+		this->notifyInput(InputEvent::KEY_DOWN, T(0), T(0), T(0), T(0), key, 0);
+		this->onKeyDown(key);
+	}
+	
+	// Call this to invoke Key-Up related events.
+	void keyUp(int key)
+	{
+		WIDGET_STATS_EVENT(EVENT_KEY_UP);
+		this->notifyInput(InputEvent::KEY_UP, T(0), T(0), T(0), T(0), key, 0);
+		this->onKeyUp(key);
+	}
+	
+	// Call this to invoke Key-Text related events.
+	void keyText(unsigned int ch)
+	{
+		WIDGET_STATS_EVENT(EVENT_KEY_TEXT);
+		this->notifyInput(InputEvent::KEY_TEXT, T(0), T(0), T(0), T(0), 0, ch);
+		this->onKeyText(ch);
+	}
+	
+	
+	/* *** Input queue *** */
+	
+	// Which consecutive queued events get merged into one. Flags may be combined.
+	enum InputCoalescing
+	{
+		// Every queued event is dispatched.
+		COALESCE_NONE = 0,
+		
+		// Consecutive mouse moves become one move to the last position, over the summed distance. (Default)
+		COALESCE_MOUSE_MOVE = 1 << 0,
+		
+		// Consecutive wheel events at the same position become one event with the summed delta. (Default)
+		COALESCE_MOUSE_WHEEL = 1 << 1
+	};
+	
+	// Set which queued events get merged. Only has an effect on the root widget of a tree.
+	void setInputCoalescing(unsigned int flags)
+	{
+		this->getTreeState().coalescing = flags;
+	}
+	
+	// Get which queued events get merged.
+	unsigned int getInputCoalescing() const
+	{
+		if (!m_internals.tree)
+			return COALESCE_MOUSE_MOVE | COALESCE_MOUSE_WHEEL;
+		
+		return m_internals.tree->coalescing;
+	}
+	
+	// Queue input instead of dispatching it right away, normally on the root widget. Queued input is dispatched by processInput(),
+	// which update() calls before updating. Positions are the same as for mouseDown() etc. `time' is up to the host.
+	void queueMouseDown(T x, T y, unsigned int b, double time = 0.)
+	{
+		this->queueInput(InputEvent::MOUSE_DOWN, time, x, y, T(0), T(0), 0, b);
+	}
+	
+	void queueMouseUp(T x, T y, unsigned int b, double time = 0.)
+	{
+		this->queueInput(InputEvent::MOUSE_UP, time, x, y, T(0), T(0), 0, b);
+	}
+	
+	void queueMouseWheel(T x, T y, int d, double time = 0.)
+	{
+		this->queueInput(InputEvent::MOUSE_WHEEL, time, x, y, T(0), T(0), d, 0);
+	}
+	
+	void queueMouseMove(T x, T y, T dx, T dy, double time = 0.)
+	{
+		this->queueInput(InputEvent::MOUSE_MOVE, time, x, y, dx, dy, 0, 0);
+	}
+	
+	void queueKeyDown(int key, double time = 0.)
+	{
+		this->queueInput(InputEvent::KEY_DOWN, time, T(0), T(0), T(0), T(0), key, 0);
+	}
+	
+	void queueKeyUp(int key, double time = 0.)
+	{
+		this->queueInput(InputEvent::KEY_UP, time, T(0), T(0), T(0), T(0), key, 0);
+	}
+	
+	void queueKeyText(unsigned int ch, double time = 0.)
+	{
+		this->queueInput(InputEvent::KEY_TEXT, time, T(0), T(0), T(0), T(0), 0, ch);
+	}
+	
+	// Get the number of queued events, after merging.
+	size_t getNumOfQueuedInput() const
+	{
+		return m_internals.tree ? m_internals.tree->input.size() : 0;
+	}
+	
+	// Dispatch all queued input, in order, in a single pass. Only has an effect on the root widget of a tree.
+	// Input queued while processing is kept for the next call.
+	void processInput()
+	{
+		if (!m_internals.tree || m_internals.tree->currentInput)
+			return;
+		
+		TreeState& tree = *m_internals.tree;
+		
+		tree.batch.clear();
+		tree.batchHistory.clear();
+		tree.batch.swap(tree.input);
+		tree.batchHistory.swap(tree.inputHistory);
+		
+		for (size_t i = 0, sz = tree.batch.size(); i < sz; ++i)
+		{
+			const InputEvent& event = tree.batch[i];
+			tree.currentInput = &event;
+			
+			switch (event.type)
+			{
+			case InputEvent::MOUSE_DOWN:  this->mouseDown(event.x, event.y, event.button); break;
+			case InputEvent::MOUSE_UP:    this->mouseUp(event.x, event.y, event.button); break;
+			case InputEvent::MOUSE_WHEEL: this->mouseWheel(event.x, event.y, event.value); break;
+			case InputEvent::MOUSE_MOVE:  this->mouseMove(event.x, event.y, event.dx, event.dy); break;
+			case InputEvent::KEY_DOWN:    this->keyDown(event.value); break;
+			case InputEvent::KEY_UP:      this->keyUp(event.value); break;
+			case InputEvent::KEY_TEXT:    this->keyText(event.button); break;
+			}
+		}
+		
+		tree.currentInput = NULL;
+	}
+	
+	// Get the queued event being dispatched by processInput(), from any widget in the tree. NULL when not processing input.
+	// Use its [first, first + count) range of getInputHistory() to see every raw event it was merged from.
+	const InputEvent* getCurrentInput() const
+	{
+		const BasicWidget* root = this->getRoot();
+		
+		return root->m_internals.tree ? root->m_internals.tree->currentInput : NULL;
+	}
+	
+	// Get every raw event (with its original timestamp) of the input being, or last, processed. From any widget in the tree.
+	const std::vector<InputEvent>& getInputHistory() const
+	{
+		static const std::vector<InputEvent> none;
+		
+		const BasicWidget* root = this->getRoot();
+		
+		if (!root->m_internals.tree)
+			return none;
+		
+		return root->m_internals.tree->batchHistory;
+	}
+	
+	// Set a listener to be told about all input given to this widget (normally the root), eg. to record it. NULL to remove it.
+	// Only has an effect on the root widget of a tree. The listener is not owned by the widget.
+	void setInputListener(InputListener* listener)
+	{
+		if (!listener && !m_internals.tree)
+			return;
+		
+		this->getTreeState().listener = listener;
+	}
+	
+	// Get the input listener. NULL if there is none.
+	InputListener* getInputListener() const
+	{
+		return m_internals.tree ? m_internals.tree->listener : NULL;
+	}
+	
+	
+#if defined(WIDGET_ENABLE_STATS)
+	
+	/* *** Statistics *** */
+	
+	// Get the statistics of events sent into this widget (normally the root.)
+	// Only available when WIDGET_ENABLE_STATS is defined. Work done by parallel updates on other threads isn't counted.
+	const Stats& getStats()
+	{
+		return this->getTreeState().stats;
+	}
+	
+	// Clear the statistics of this tree, including the times of every subtree.
+	void resetStats()
+	{
+		this->getTreeState().stats.reset();
+		this->resetSubtreeTimes();
+	}
+	
+	// Get the seconds spent in onUpdate() of this widget and its children, since the stats were last reset.
+	double getSubtreeUpdateTime() const
+	{
+		return m_internals.updateTime;
+	}
+	
+	// Get the seconds spent in onDraw() of this widget and its children, since the stats were last reset.
+	double getSubtreeDrawTime() const
+	{
+		return m_internals.drawTime;
+	}
+	
+#endif
+	
+protected:
+	
+	
+	/* *** Widget events *** */
+	
+	// When the widget updates. Not called while the widget is sleeping, see setSleeping().
+	// NOTE: Inherited classes should invoke this method for the super-class.
+	virtual void onUpdate(double dt)
+	{
+		WIDGET_STATS_VISIT(EVENT_UPDATE);
+		
+		BasicWidget* widget;
+		UpdatePass* pass = currentPass();
+		
+		// Check for mouse entering/leaving. With an executor, this was already done before updating.
+		BasicWidget* lastHover = pass ? m_internals.hover : this->refreshHover();
+		
+		std::vector<BasicWidget*> parallel;
+		
+		// Update all children.
+		for (size_t i = 0, sz = m_internals.widgets.size(); i < sz; ++i)
+		{
+			// Skip holes left by removed or raised children.
+			if (!(widget = m_internals.widgets[i]))
+				continue;
+			
+			if (!this->needsUpdate(widget, lastHover))
+				continue;
+			
+			if (!pass)
+				this->passMouseCurrent(widget);
+			
+			// Parallel children are updated together, after the serial ones.
+			if (pass && pass->executor && widget->m_internals.parallelUpdate)
+			{
+				parallel.push_back(widget);
+				continue;
+			}
+			
+			widget->updateTree(dt);
+		}
+		
+		if (!parallel.empty())
+			this->updateParallel(*pass->executor, parallel, dt);
+	}
+	
+	// When the widget is supposed to be rendered.
+	// NOTE: Inherited classes should invoke this method for the super-class.
+	virtual void onDraw(T scrx, T scry, void* udata = NULL)
+	{
+		WIDGET_STATS_VISIT(EVENT_DRAW);
+		
+		if (m_internals.hidden)
+			return;
+		
+		BasicWidget* widget;
+		DrawContext* ctx = m_internals.drawCtx;
+		
+		// Narrow the clip down to this widget for its children.
+		Rect oldClip;
+		bool oldClipped = false;
+		
+		if (ctx && m_internals.clipChildren)
+		{
+			oldClip = ctx->clip;
+			oldClipped = ctx->clipped;
+			
+			Rect bounds(scrx, scry, width, height);
+			
+			if (ctx->clipped)
+				ctx->clip.clip(bounds);
+			else
+				ctx->clip = bounds;
+			
+			ctx->clipped = true;
+		}
+		
+		// Draw all children.
+		for (size_t i = 0, sz = m_internals.widgets.size(); i < sz; ++i)
+		{
+			widget = m_internals.widgets[i];
+			
+			if (!widget || widget->m_internals.hidden)
+				continue;
+			
+			if (!ctx)
+			{
+				callDraw(widget, widget->x + scrx, widget->y + scry, udata);
+				continue;
+			}
+			
+			Rect bounds(widget->x + scrx, widget->y + scry, widget->width, widget->height);
+			
+			// Skip children that are clipped away, or don't touch any damaged area.
+			if (widget->isContained())
+			{
+				if (ctx->clipped && !ctx->clip.intersects(bounds))
+					continue;
+				
+				if (!ctx->fullRedraw && !isDamaged(*ctx, bounds))
+					continue;
+			}
+			
+			widget->m_internals.drawCtx = ctx;
+			callDraw(widget, bounds.x, bounds.y, udata);
+			widget->m_internals.drawCtx = NULL;
+		}
+		
+		if (ctx && m_internals.clipChildren)
+		{
+			ctx->clip = oldClip;
+			ctx->clipped = oldClipped;
+		}
+	}
+	
+	// When a mouse button is down.
+	// NOTE: Inherited classes should invoke this method for the super-class.
+	virtual void onMouseDown(T x, T y, unsigned int b)
+	{
+		WIDGET_STATS_VISIT(EVENT_MOUSE_DOWN);
+		
+		if (m_internals.hidden)
+			return;
+		
+		BasicWidget* widget;
+		
+		m_internals.mouseInsideChild = false;
+		
+		bool mouseInside = (x >= T(0) && x < this->width && y >= T(0) && y < this->height);
+		
+		if (!(m_internals.dispatch & DISPATCH_CULLED_MOUSE_DOWN))
+		{
+			// Send mouse-down signal to all children.
+			for (size_t i = m_internals.widgets.size(); i--;)
+			{
+				if ((widget = m_internals.widgets[i]))
+					widget->onMouseDown(x - widget->x, y - widget->y, b);
+			}
+		}
+		else
+		{
+			// Only the child under the mouse can be pressed, the others only need the mouse down if they watch presses.
+			BasicWidget* target = mouseInside ? this->findChildAt(x, y, true) : NULL;
+			unsigned int watchers = m_internals.counts[COUNT_PRESS_WATCHERS] - (m_internals.pressWatch ? 1 : 0);
+			
+			if (watchers == 0)
+			{
+				if (target)
+					target->onMouseDown(x - target->x, y - target->y, b);
+			}
+			else
+			{
+				for (size_t i = m_internals.widgets.size(); i--;)
+				{
+					if ((widget = m_internals.widgets[i]) && (widget == target || widget->m_internals.counts[COUNT_PRESS_WATCHERS]))
+						widget->onMouseDown(x - widget->x, y - widget->y, b);
+				}
+			}
+		}
+		
+		// If the mouse is inside this widget.
+		if (mouseInside)
+		{
+			
+			// Check for any mouse-downs inside of a child widget.
+			// When found, push to the back, making it the focused widget.
+			widget = this->findChildAt(x, y, true);
+			
+			if (widget)
+			{
+				m_internals.mouseInsideChild = true;
+				
+				// Widget is being held down.
+				if (!widget->m_internals.down)
+					widget->setHeldDown(true, b);
+				
+				// Make this widget the focused child.
+				this->setFocus(widget);
+				
+				if (!widget->m_internals.mouseInsideChild)
+				{
+					// Mouse pressed.
+					widget->onPress(x - widget->x,  y - widget->y, b);
+				}
+			}
+			
+		}
+	}
+	
+	// When a mouse button is up.
+	// NOTE: Inherited classes should invoke this method for the super-class.
+	virtual void onMouseUp(T x, T y, unsigned int b)
 	{
-		std::vector<Widget*> widgets; /* Back-most widget is focused and/or top. */
-		Widget* parent;
-
-		bool down;
-		unsigned int downBtn;
-		bool mouseInsideChild;
-		Widget* hover;
+		WIDGET_STATS_VISIT(EVENT_MOUSE_UP);
 		
-		bool hidden;
-
-		double mouseX, mouseY;
-
-	} m_internals;
-	
-protected:
-	
-	// These are protected so Widget classes can work with these internally.
-	// Modifying these will not call onMove/onResize, you must call these events manually when appropriate.
-	double x, y, width, height;
-	
-public:
-	
-	/* *** Contruction/Deconstruction *** */
-	
-	Widget()
-	{
-		x = 0.; y = 0.;
-		width = 0.; height = 0.;
+		if (m_internals.hidden)
+			return;
 		
-		m_internals.parent = NULL;
-		m_internals.hover = NULL;
+		BasicWidget* widget;
 		
-		m_internals.down = false;
-		m_internals.downBtn = 0;
 		m_internals.mouseInsideChild = false;
 		
-		m_internals.hidden = false;
-		m_internals.mouseX = 0.;
-		m_internals.mouseY = 0.;
-	}
-	
-	
-	virtual ~Widget()
-	{
+		// With DISPATCH_CAPTURED_MOUSE_UP, only the children on the way to a held-down or capturing widget get the mouse up.
+		size_t first = 0, last = m_internals.widgets.size();
+		const CaptureEdge* edges = this->getReleaseEdges(first, last);
 		
-	}
-	
-	
-	/* *** Transformation *** */
-	
-	void move(double movex, double movey)
-	{
-		x += movex;
-		y += movey;
+		// Send mouse-up signal to all children.
+		for (size_t i = last; i-- > first;)
+		{
+			if ((widget = edges ? edges[i].child : m_internals.widgets[i]))
+				widget->onMouseUp(x - widget->x, y - widget->y, b);
+		}
 		
-		this->onMove(movex, movey);
-	}
-	
-	void setPosition(double posx, double posy)
-	{
-		double oldx = x, oldy = y;
-		x = posx;
-		y = posy;
+		bool mouseInsideThis = ( x >= T(0) && x < this->width && y >= T(0) && y < this->height );
 		
-		this->onMove(x - oldx, y - oldy);
-	}
-	
-	inline void getPosition(double& out_x, double& out_y) const
-	{
-		out_x = x;
-		out_y = y; 
-	}
-	
-	inline double getPositionX() const
-	{
-		return x;
-	}
-	
-	inline double getPositionY() const
-	{
-		return y;
-	}
-	
-	
-	void setSize(double sizewidth, double sizeheight)
-	{
-		width = sizewidth;
-		height = sizeheight;
+		// Check for any mouse-ups inside of a child widget.
+		m_internals.mouseInsideChild = (this->findChildAt(x, y, false) != NULL);
 		
-		this->onResize();
-	}
-	
-	inline void getSize(double& out_width, double& out_height) const
-	{
-		out_width = width;
-		out_height = height;
-	}
-	
-	inline double getWidth() const
-	{
-		return width;
+		for (size_t i = last; i-- > first;)
+		{
+			widget = edges ? edges[i].child : m_internals.widgets[i];
+			
+			if (widget && widget->m_internals.down && widget->m_internals.downBtn == b)
+			{
+				// No longer held down.
+				widget->setHeldDown(false, b);
+				
+				if (widget->m_internals.hidden)
+					continue;
+				
+				// Mouse released this widget.
+				widget->onRelease(x - widget->x, y - widget->y, b);
+					
+				if (mouseInsideThis && !widget->m_internals.mouseInsideChild)
+				{
+					// Check if mouse was inside.
+					if (x >= widget->x && x < widget->x + widget->width &&
+						y >= widget->y && y < widget->y + widget->height )
+					{
+						// Widget was clicked.
+						widget->onClick(x - widget->x, y - widget->y, b);
+					}
+				}
+			}
+		}
 	}
 	
-	inline double getHeight() const
+	// When the mouse wheel moves.
+	// NOTE: Inherited classes should invoke this method for the super-class.
+	virtual void onMouseWheel(T x, T y, int d)
 	{
-		return height;
+		WIDGET_STATS_VISIT(EVENT_MOUSE_WHEEL);
+		
+		BasicWidget* widget;
+		
+		// Send mouse-wheel signal to all children.
+		for (size_t i = 0, sz = m_internals.widgets.size(); i < sz; ++i)
+		{
+			if ((widget = m_internals.widgets[i]))
+				widget->onMouseWheel(x - widget->x, y - widget->y, d);
+		}
 	}
 	
-	
-	/* *** Visibility *** */
-	
-	// Check if we're hidden or if our parents are hidden.
-	bool isHidden() const
+	// When the mouse moves.
+	// NOTE: Inherited classes should invoke this method for the super-class.
+	virtual void onMouseMove(T x, T y, T dx, T dy)
 	{
-		const Widget* cur = this;
+		WIDGET_STATS_VISIT(EVENT_MOUSE_MOVE);
+		
+		BasicWidget* widget;
+		
+		// Update mouse positions.
+		m_internals.mouseX = x;
+		m_internals.mouseY = y;
+		m_internals.hoverDirty = true;
 		
-		// Check if we're hidden, or if our higher-level parents are hidden.
-		do
+		if (!(m_internals.dispatch & DISPATCH_CULLED_MOUSE_MOVE))
 		{
-			if (cur->m_internals.hidden)
-				return true;
+			// Send mouse-move signal to all children.
+			for (size_t i = 0, sz = m_internals.widgets.size(); i < sz; ++i)
+			{
+				if ((widget = m_internals.widgets[i]))
+					this->sendMouseMove(widget, x, y, dx, dy);
+			}
 			
-			// Process the next parent.
-			cur = cur->m_internals.parent;
+			return;
 		}
-		while (cur);
 		
-		return false;
+		// The last target gets this move too, so it sees the mouse leave.
+		BasicWidget* lastTarget = m_internals.moveTarget;
+		BasicWidget* target = this->findChildAt(x, y, false);
+		m_internals.moveTarget = target;
+		
+		unsigned int tracking =
+			m_internals.counts[COUNT_MOUSE_TRACKERS] - (m_internals.mouseTrack ? 1 : 0) +
+			m_internals.counts[COUNT_PRESSED] - (m_internals.down ? 1 : 0) +
+			m_internals.counts[COUNT_CAPTURING] - (m_internals.captured ? 1 : 0);
+		
+		if (tracking == 0)
+		{
+			// Only the widgets under the mouse, now and last time, need the move.
+			if (lastTarget && lastTarget != target)
+				this->sendMouseMove(lastTarget, x, y, dx, dy);
+			
+			if (target)
+				this->sendMouseMove(target, x, y, dx, dy);
+			
+			return;
+		}
+		
+		// Some children are held down, capture or track the mouse, look for them.
+		for (size_t i = 0, sz = m_internals.widgets.size(); i < sz; ++i)
+		{
+			if (!(widget = m_internals.widgets[i]))
+				continue;
+			
+			if (widget == target || widget == lastTarget || widget->m_internals.counts[COUNT_MOUSE_TRACKERS] ||
+				widget->m_internals.counts[COUNT_PRESSED] || widget->m_internals.counts[COUNT_CAPTURING])
+			{
+				this->sendMouseMove(widget, x, y, dx, dy);
+			}
+		}
 	}
 	
-	// Hide this widget and children.
-	void hide(bool hidden = true)
+	// When a keyboard key is down.
+	// NOTE: Inherited classes should invoke this method for the super-class.
+	virtual void onKeyDown(int key)
 	{
-		m_internals.hidden = hidden;
+		WIDGET_STATS_VISIT(EVENT_KEY_DOWN);
+		
+		// Send key-down signal to all children.
+		this->dispatchKeyEvent(&BasicWidget::onKeyDown, key);
 	}
 	
-	
-	/* *** Modify children *** */
-	
-	// Add a child widget to this widget.
-	void addWidget(Widget* widget)
+	// When a keyboard key is up.
+	// NOTE: Inherited classes should invoke this method for the super-class.
+	virtual void onKeyUp(int key)
 	{
-		// Push the new child to the back. (It will become the focused widget)
-		m_internals.widgets.push_back(widget);
-		widget->m_internals.parent = this;
+		WIDGET_STATS_VISIT(EVENT_KEY_UP);
 		
-		// Call widget Adopt events.
-		this->onAdopt(*widget);
-		widget->onAdopted(*this);
+		// Send key-up signal to all children.
+		this->dispatchKeyEvent(&BasicWidget::onKeyUp, key);
 	}
 	
-	// Remove a child widget from this widget.
-	bool removeWidget(Widget* widget)
+	// When a character is entered. (Useful for widgets like textboxes)
+	// NOTE: Inherited classes should invoke this method for the super-class.
+	virtual void onKeyText(unsigned int ch)
 	{
-		Widget* child;
-		
-		// Find widget.
-		for (size_t i = m_internals.widgets.size(); i--;)
-		{
-			child = m_internals.widgets[i];
-			if (child == widget)
-			{
-				// Remove it from children.
-				child->m_internals.parent = NULL;
-				m_internals.widgets.erase(m_internals.widgets.begin() + i);
-				
-				// Call widget Disown events.
-				this->onDisown(*child);
-				child->onDisowned(*this);
-				
-				return true;
-			}
-		}
+		WIDGET_STATS_VISIT(EVENT_KEY_TEXT);
 		
-		return false;
+		// Send text signal to all children.
+		this->dispatchKeyEvent(&BasicWidget::onKeyText, ch);
 	}
 	
-	// Check if this widget parents a specific child widget.
-	bool hasWidget(const Widget& widget) const
+	
+	// When this widget has moved.
+	virtual void onMove(T dx, T dy)
 	{
-		// Find widget.
-		for (size_t i = m_internals.widgets.size(); i--;)
-		{
-			if (m_internals.widgets[i] == &widget)
-				return true;
-		}
 		
-		return false;
 	}
 	
-	
-	/* *** Widget parent *** */
-	
-	// Does this widget have a parent?
-	bool hasParent() const
+	// When the widget is resized.
+	virtual void onResize()
 	{
-		return m_internals.parent != NULL;
+		
 	}
 	
-	// Returns the parent widget. Returns NULL if no parent.
-	Widget* getParent()
+	// When the mouse presses inside this widget.
+	virtual void onPress(T x, T y, unsigned int b)
 	{
-		return m_internals.parent;
+		
 	}
 	
-	// Returns the parent widget. Returns NULL if no parent.
-	const Widget* getParent() const
+	// When the mouse releases.
+	virtual void onRelease(T x, T y, unsigned int b)
 	{
-		return m_internals.parent;
+		
 	}
 	
-	
-	/* *** Widget children *** */
-	
-	// Does this widget contain children widgets?
-	bool hasChildren() const
+	// When the mouse clicks this widget. (Useful for widgets like buttons)
+	// (When the mouse has pressed this widget and released with the mouse inside.)
+	virtual void onClick(T x, T y, unsigned int b)
 	{
-		return m_internals.widgets.size() > 0;
+		
 	}
 	
-	// Get a child as specific index. Index must valid (in bounds).
-	Widget* getChild(size_t idx)
+	// When the user focuses on this widget.
+	virtual void onFocusGained()
 	{
-		return m_internals.widgets[idx];
+		
 	}
 	
-	// Get a child as specific index. Index must valid (in bounds).
-	const Widget* getChild(size_t idx) const
+	// When the user defocuses from this widget.
+	virtual void onFocusLost()
 	{
-		return m_internals.widgets[idx];
+		
 	}
 	
-	// Get the number of children this widget parents.
-	size_t getNumOfChildren() const
+	// When the mouse entered inside the widget.
+	virtual void onMouseEnter(T x, T y)
 	{
-		return m_internals.widgets.size();
+		
 	}
 	
-	
-	/* *** Widget focus *** */
-	
-	// Force child at index to be the focused widget. This function does nothing if index is not valid (not in bounds).
-	void setFocus(size_t idx)
+	// When the mouse left outside the widget.
+	virtual void onMouseLeave(T x, T y)
 	{
-		Widget* widget;
-		
-		if (idx >= m_internals.widgets.size())
-			return;
-		
-		widget = m_internals.widgets[idx];
-		
-		// Don't do anything if widget is already focused.
-		if (widget->isFocusedChild())
-			return;
 		
-		// Make it the focused object.
-		m_internals.widgets.push_back(widget);
-		m_internals.widgets.erase(m_internals.widgets.begin()+idx);
+	}
+	
+	// When this widget adopts a child widget.
+	virtual void onAdopt(BasicWidget& child)
+	{
 		
-		// Call lost/gained focus events.
-		m_internals.widgets[m_internals.widgets.size()-2]->onFocusLost();
-		widget->onFocusGained();
 	}
 	
-	// Force child to be the focused widget. The child must be a child of this widget, else this function does nothing.
-	void setFocus(const Widget* child)
+	// When this widget disowns a child widget.
+	virtual void onDisown(BasicWidget& child)
 	{
-		Widget* widget;
 		
-		// Find child.
-		for (size_t i = m_internals.widgets.size(); i--;)
-		{
-			widget = m_internals.widgets[i];
-			
-			if (widget == child)
-			{
-				// Don't do anything if widget is already focused.
-				if (widget->isFocused())
-					return;
-				
-				// Make it the focused object.
-				m_internals.widgets.push_back(widget);
-				m_internals.widgets.erase(m_internals.widgets.begin()+i);
-				
-				// Call lost/gained focus events.
-				m_internals.widgets[m_internals.widgets.size()-2]->onFocusLost();
-				widget->onFocusGained();
-			}
-		}
 	}
 	
-	// Get the focused child. Returns NULL if no children are present.
-	Widget* getFocused()
+	// When this widget has been adopted.
+	virtual void onAdopted(BasicWidget& parent)
 	{
-		// Return NULL if empty.
-		if (m_internals.widgets.empty())
-			return NULL;
 		
-		// The back widget is the focused component.
-		return m_internals.widgets.back();
 	}
 	
-	// Get the focused child. Returns NULL if no children are present.
-	const Widget* getFocused() const
+	// When this widget has been disowned.
+	virtual void onDisowned(BasicWidget& parent)
 	{
-		// Return NULL if empty.
-		if (m_internals.widgets.empty())
-			return NULL;
 		
-		// The back widget is the focused component.
-		return m_internals.widgets.back();
 	}
 	
-	// Is this widget the focused widget of the parent? Always returns true if no parent is present.
-	bool isFocused() const
+	// When a child widget has been resized.
+	virtual void onChildResize(BasicWidget& child)
+	{
+		
+	}
+	
+private:
+	
+	// Find the top-most child containing [x, y] (relative to this widget.) Returns NULL if none.
+	BasicWidget* findChildAt(T x, T y, bool skipHidden) const
 	{
-		const Widget* cur = this;
+		BasicWidget* widget;
 		
-		do
+		if (m_internals.index)
+			return m_internals.index->hitTest(x, y, skipHidden);
+		
+		if (const ChildBounds* bounds = m_internals.widgets.getBounds())
 		{
-			if (cur->isFocusedChild())
+			size_t i = m_internals.widgets.size();
+			
+			// Holes have empty bounds, so they are never hit.
+			while (bounds->hitTest(x, y, i, i))
 			{
-				// Process the parent if this is the focused child.
-				cur = cur->m_internals.parent;
+				widget = m_internals.widgets[i];
+				
+				if (!skipHidden || !widget->m_internals.hidden)
+					return widget;
 			}
-			else
+			
+			return NULL;
+		}
+		
+		for (size_t i = m_internals.widgets.size(); i--;)
+		{
+			widget = m_internals.widgets[i];
+			
+			if (!widget || (skipHidden && widget->m_internals.hidden))
+				continue;
+			
+			if (x >= widget->x && x < widget->x + widget->width &&
+				y >= widget->y && y < widget->y + widget->height )
 			{
-				// Always return false if this is not the focused child.
-				return false;
+				return widget;
 			}
 		}
-		while (cur);
 		
-		// Always return true if there's no parent.
-		return true;
+		return NULL;
 	}
 	
-	// Is this widget the focused widget of the parent? Always returns true if no parent is present.
-	bool isFocusedChild() const
+	// Send a key event to children. With DISPATCH_FOCUSED_KEYS, only the focused child and the key snoopers below us receive it.
+	template <typename A>
+	void dispatchKeyEvent(void (BasicWidget::*event)(A), A arg)
 	{
-		// Check if we're the parent's focused child.
-		if (m_internals.parent)
-			return m_internals.parent->getFocused() == this;
+		size_t sz = m_internals.widgets.size();
+		BasicWidget* widget;
 		
-		// Always return true if no parent.
-		return true;
-	}
-	
-	// Try to pop this widget out of focus and make the next sibling widget in focus instead.
-	void popFocus()
-	{
-		// This should be the focused child.
-		if (!this->isFocusedChild())
+		if (!(m_internals.dispatch & DISPATCH_FOCUSED_KEYS))
+		{
+			for (size_t i = 0; i < sz; ++i)
+			{
+				if ((widget = m_internals.widgets[i]))
+					(widget->*event)(arg);
+			}
+			
 			return;
+		}
 		
-		// Can't pop if there is no parent.
-		if (!m_internals.parent)
+		if (sz == 0)
 			return;
 		
-		// Can't pop if this is the only child.
-		if (m_internals.parent->m_internals.widgets.size() < 2)
+		// Off the focus chain, only snoopers get the event, not our focused child.
+		bool offChain = keysOffChain();
+		
+		// Without snoopers below us, the event only needs to go to the focused child.
+		unsigned int snoopers = m_internals.counts[COUNT_KEY_SNOOPERS] - (m_internals.keySnoop ? 1 : 0);
+		
+		if (snoopers == 0)
+		{
+			if (!offChain)
+				(m_internals.widgets.back()->*event)(arg);
+			
 			return;
+		}
 		
-		// Set the second child into focus.
-		m_internals.parent->setFocus(m_internals.parent->m_internals.widgets.size()-2);
+		for (size_t i = 0; i < sz; ++i)
+		{
+			if (!(widget = m_internals.widgets[i]))
+				continue;
+			
+			// The back-most widget is the focused one.
+			if (i == sz-1 && !offChain)
+				(widget->*event)(arg);
+			else if (widget->m_internals.counts[COUNT_KEY_SNOOPERS])
+				widget->forwardKeyEvent(event, arg);
+		}
 	}
 	
-	
-	/* *** Mouse interactivity *** */
-	
-	// Is the mouse holding this widget? Optionally, it will return which mouse button is holding the widget down via `btn'.
-	bool isHeldDown(unsigned int* btn = NULL) const
+	// Send a key event to the key snoopers in this subtree, which is off the focus chain. The widgets on the way there don't
+	// get it.
+	template <typename A>
+	void forwardKeyEvent(void (BasicWidget::*event)(A), A arg)
 	{
-		if (m_internals.down)
+		if (m_internals.keySnoop)
 		{
-			*btn = m_internals.downBtn;
-			return true;
+			// The snooper passes the event on to the snoopers below it, when calling the super-class.
+			bool& offChain = keysOffChain();
+			bool wasOffChain = offChain;
+			offChain = true;
+			
+			(this->*event)(arg);
+			
+			offChain = wasOffChain;
+			return;
+		}
+		
+		BasicWidget* widget;
+		
+		for (size_t i = 0, sz = m_internals.widgets.size(); i < sz; ++i)
+		{
+			if ((widget = m_internals.widgets[i]) && widget->m_internals.counts[COUNT_KEY_SNOOPERS])
+				widget->forwardKeyEvent(event, arg);
 		}
-		return false;
 	}
 	
-	// Is the mouse hovering over this widget?
-	bool isMouseHovering() const
+	// Is a key event being sent off the focus chain? (See forwardKeyEvent().)
+	static bool& keysOffChain()
 	{
-		// Check if the hovering component is this widget.
-		if (m_internals.parent)
-			return m_internals.parent->m_internals.hover == this;
-		
-		// Always return false if no m_internals.parent.
-		return false;
+		static thread_local bool offChain = false;
+		return offChain;
 	}
 	
-	// Get the relative mouse position.
-	double getRelativeMouseX() const
+	// Update the cached focus state after the focused child changed from `oldFocus' to `newFocus'. Either may be NULL.
+	void focusMoved(BasicWidget* oldFocus, BasicWidget* newFocus)
 	{
-		return m_internals.mouseX;
+		if (oldFocus == newFocus)
+			return;
+		
+		if (oldFocus)
+		{
+			oldFocus->m_internals.focusedChild = false;
+			oldFocus->setFocusChain(false);
+		}
+		
+		if (newFocus)
+		{
+			newFocus->m_internals.focusedChild = true;
+			newFocus->setFocusChain(m_internals.effFocused);
+		}
 	}
 	
-	// Get the relative mouse position.
-	double getRelativeMouseY() const
+	// Set the effective focus of this widget and its chain of focused children.
+	void setFocusChain(bool focused)
 	{
-		return m_internals.mouseY;
+		// Focused children always share their parent's effective focus, so stop once it is already right.
+		for (BasicWidget* cur = this; cur && cur->m_internals.effFocused != focused; cur = cur->getFocused())
+			cur->m_internals.effFocused = focused;
 	}
 	
-	// Get relative mouse position.
-	void getRelatieMousePos(double& x, double& y) const
+	// Work out whether this widget is effectively hidden again, passing any change on to the children.
+	void refreshHidden()
 	{
-		x = m_internals.mouseX;
-		y = m_internals.mouseY;
+		bool hidden = m_internals.hidden || (m_internals.parent && m_internals.parent->m_internals.effHidden);
+		
+		if (hidden == m_internals.effHidden)
+			return;
+		
+		m_internals.effHidden = hidden;
+		
+		for (size_t i = 0, sz = m_internals.widgets.size(); i < sz; ++i)
+		{
+			if (m_internals.widgets[i])
+				m_internals.widgets[i]->refreshHidden();
+		}
 	}
 	
-	
-	/* *** Invoke events *** */
-	
-	// Update this and child widgets.
-	void update(double dt)
+	// Destroy a widget made with create(), and give its memory back to its pool. The widget must not have a parent.
+	static void freeOwned(BasicWidget* widget)
 	{
-		this->onUpdate(dt);
+		WidgetPool* pool = widget->m_internals.pool;
+		size_t size = widget->m_internals.blockSize;
+		
+		widget->~BasicWidget();
+		pool->deallocate(widget, size);
 	}
 	
-	// Render this and child widgets.
-	void draw(void* udata = NULL)
+	// The update pass running on this thread. NULL outside of updates with an executor.
+	static UpdatePass*& currentPass()
 	{
-		this->onDraw(this->x, this->y, udata);
+		static thread_local UpdatePass* pass = NULL;
+		return pass;
 	}
 	
-	// Call this to invoke Mouse-Down related events.
-	// Mouse positions [x, y] here must be relative to the position of the parent widget (if any.)
-	// ie. Use global/screen/window mouse positions if this is the root widget.
-	void mouseDown(double x, double y, unsigned int b)
+	// Work out which child the mouse is over, calling MouseEnter/MouseLeave events. Returns the child it was over before.
+	// Only done when the mouse moved or the children changed since the last time, a still mouse costs nothing.
+	BasicWidget* refreshHover()
 	{
-		if (m_internals.hidden)
-			return;
+		if (!m_internals.hoverDirty)
+			return m_internals.hover;
 		
-		this->onMouseDown(x, y, b);
+		m_internals.hoverDirty = false;
 		
-		if (m_internals.mouseInsideChild)
-			return;
+		// With culled mouse moves, a widget that missed the latest move does not have the mouse over it.
+		BasicWidget* widget = NULL;
+		if (m_internals.mouseCurrent)
+			widget = this->findChildAt(m_internals.mouseX, m_internals.mouseY, false);
+		bool hovering = (widget != NULL);
+		BasicWidget* lastHover = m_internals.hover;
 		
-		if (x >= this->x && x < this->x + this->width &&
-			y >= this->y && y < this->y + this->height )
+		// If mouse is already hovering, no need to do anything.
+		if (hovering && m_internals.hover != widget)
 		{
-			// This widget is being held down.
-			if (!m_internals.down)
-			{
-				m_internals.down = true;
-				m_internals.downBtn = b;
-			}
+			// Change mouse hover to new widget.
+			BasicWidget* oldHover = m_internals.hover;
+			m_internals.hover = widget;
 			
-			// Mouse pressed.
-			this->onPress(x - this->x,  y - this->y, b);
+			// Call widget events.
+			if (oldHover)
+				oldHover->onMouseLeave(m_internals.mouseX, m_internals.mouseY);
+			
+			widget->onMouseEnter(m_internals.mouseX, m_internals.mouseY);
+		}
+		
+		// If not hovering over anything, leave old hover widget (if any.)
+		if (!hovering && this->m_internals.hover)
+		{
+			m_internals.hover->onMouseLeave(m_internals.mouseX, m_internals.mouseY);
+			m_internals.hover = NULL;
 		}
+		
+		return lastHover;
 	}
 	
-	// Call this to invoke Mouse-Up related events.
-	// Mouse positions [x, y] here must be relative to the position of the parent widget (if any.)
-	// ie. Use global/screen/window mouse positions if this is the root widget.
-	void mouseUp(double x, double y, unsigned int b)
+	// Work out hover for this widget and every widget below it that update would visit.
+	void updateHover()
 	{
-		if (m_internals.hidden)
-			return;
+		BasicWidget* widget;
+		BasicWidget* lastHover = this->refreshHover();
 		
-		this->onMouseUp(x, y, b);
-		
-		if (m_internals.down && m_internals.downBtn == b)
+		for (size_t i = 0, sz = m_internals.widgets.size(); i < sz; ++i)
 		{
-			// No longer held down.
-			m_internals.down = false;
-			
-			// Mouse released this widget.
-			this->onRelease(x - this->x, y - this->y, b);
-			
-			if (m_internals.mouseInsideChild)
-				return;
+			if (!(widget = m_internals.widgets[i]) || !this->needsUpdate(widget, lastHover))
+				continue;
 			
-			// Check if mouse was inside.
-			if (x >= this->x && x < this->x + this->width &&
-				y >= this->y && y < this->y + this->height )
-			{
-				// Widget was clicked.
-				this->onClick(x - this->x, y - this->y, b);
-			}
+			this->passMouseCurrent(widget);
+			widget->updateHover();
 		}
 	}
 	
-	// Call this to invoke Mouse-Wheel related events.
-	// Mouse positions [x, y] here must be relative to the position of the parent widget (if any.)
-	// ie. Use global/screen/window mouse positions if this is the root widget.
-	void mouseWheel(double x, double y, int d)
+	// Does a child need a visit during update? Sleeping subtrees only do if the mouse is (or just was) over them.
+	bool needsUpdate(const BasicWidget* child, const BasicWidget* lastHover) const
 	{
-		this->onMouseWheel(x, y, d);
+		return child->m_internals.counts[COUNT_AWAKE] || child->m_internals.counts[COUNT_SCHEDULED] ||
+			child == m_internals.hover || child == lastHover;
 	}
 	
-	// Call this to invoke Mouse-Move related events.
-	// Mouse positions [x, y] here must be relative to the position of the parent widget (if any.)
-	// ie. Use global/screen/window mouse positions if this is the root widget.
-	void mouseMove(double x, double y, double dx, double dy)
+	// Get a geometry version no tree has had before. Versions are unique across trees, so a subtree moving to another tree
+	// never finds its new tree at a version it has seen.
+	static unsigned long newGeometryVersion()
 	{
-		this->onMouseMove(x, y, dx, dy);
+		static std::atomic<unsigned long> last(0);
+		return last.fetch_add(1, std::memory_order_relaxed) + 1;
 	}
 	
-	
-	// Call this to invoke Key-Down related events.
-	void keyDown(int key)
+	// Something in this widget's tree moved, resized, changed parent, z-order or visibility. Screen indices built before are stale.
+	// Only the root's version changes, so other trees (and their indices) are left alone.
+	void geometryChanged()
 	{
-		this->onKeyDown(key);
+		BasicWidget* root = this->getRoot();
+		
+		if (root->m_internals.tree)
+			root->m_internals.tree->geometry.store(newGeometryVersion(), std::memory_order_relaxed);
 	}
 	
-	// Call this to invoke Key-Up related events.
-	void keyUp(int key)
+	// Get the screen index of this root's tree, building it if anything changed since it was last built.
+	// Returns NULL while the tree changes between queries: building costs a pass over the whole tree, walking down it for
+	// one query is cheaper.
+	ScreenIndex* getScreenIndex()
 	{
-		this->onKeyUp(key);
+		TreeState& tree = this->getTreeState();
+		
+		if (!tree.screenIndex)
+			tree.screenIndex = new ScreenIndex();
+		
+		unsigned long version = tree.geometry.load(std::memory_order_relaxed);
+		
+		if (!tree.screenIndex->isCurrent(version))
+		{
+			if (!tree.screenIndex->wasQueried(version))
+				return NULL;
+			
+			tree.screenIndex->build(this, version);
+		}
+		
+		return tree.screenIndex;
 	}
 	
-	// Call this to invoke Key-Text related events.
-	void keyText(unsigned int ch)
+	// Add this widget and its visible children overlapping `rect' (in screen coordinates) to `out', in drawing order.
+	// This widget is at [absx, absy] on the screen, and `bounds' are its screen bounds clipped to its parents.
+	void findInRect(const Rect& rect, T absx, T absy, const Rect& bounds, std::vector<BasicWidget*>& out)
 	{
-		this->onKeyText(ch);
+		if (!rect.intersects(bounds))
+			return;
+		
+		out.push_back(this);
+		
+		for (size_t i = 0, sz = m_internals.widgets.size(); i < sz; ++i)
+		{
+			BasicWidget* child = m_internals.widgets[i];
+			
+			if (!child || child->m_internals.hidden)
+				continue;
+			
+			Rect childBounds(absx + child->x, absy + child->y, child->width, child->height);
+			childBounds.clip(bounds);
+			
+			if (!childBounds.isEmpty())
+				child->findInRect(rect, absx + child->x, absy + child->y, childBounds, out);
+		}
 	}
 	
-protected:
-	
-	
-	/* *** Widget events *** */
+	// Tell a child whether it received the latest mouse move.
+	void passMouseCurrent(BasicWidget* child) const
+	{
+		bool current = m_internals.mouseCurrent &&
+			(!(m_internals.dispatch & DISPATCH_CULLED_MOUSE_MOVE) || child->m_internals.moveStamp == m_internals.moveStamp);
+		
+		if (child->m_internals.mouseCurrent != current)
+		{
+			child->m_internals.mouseCurrent = current;
+			child->m_internals.hoverDirty = true;
+		}
+	}
 	
-	// When the widget updates.
-	// NOTE: Inherited classes should invoke this method for the super-class.
-	virtual void onUpdate(double dt)
+	// Update children on the executor, then apply what they changed outside of their subtrees, in child order.
+	void updateParallel(UpdateExecutor& executor, const std::vector<BasicWidget*>& children, double dt)
 	{
-		Widget* widget;
+		std::vector<UpdatePass> passes(children.size());
 		
-		// Check for mouse entering/leaving.
-		bool hovering = false;
-		for (size_t i = m_internals.widgets.size(); i--;)
+		for (size_t i = 0, sz = children.size(); i < sz; ++i)
 		{
-			widget = m_internals.widgets[i];
+			passes[i].top = children[i];
 			
-			if (m_internals.mouseX >= widget->x && m_internals.mouseX < widget->x + widget->width &&
-				m_internals.mouseY >= widget->y && m_internals.mouseY < widget->y + widget->height )
+			for (int c = 0; c < NUM_SUBTREE_COUNTERS; ++c)
+				passes[i].counts[c] = children[i]->m_internals.counts[c];
+		}
+		
+		ParallelTask task;
+		task.children = &children[0];
+		task.passes = &passes[0];
+		task.dt = dt;
+		
+		executor.run(children.size(), &BasicWidget::runParallelTask, &task);
+		
+		for (size_t i = 0, sz = children.size(); i < sz; ++i)
+		{
+			for (int c = 0; c < NUM_SUBTREE_COUNTERS; ++c)
 			{
-				hovering = true;
-				
-				// If mouse is already hovering, no need to do anything.
-				if (m_internals.hover == widget)
-					break;
-				
-				// Change mouse hover to new widget.
-				Widget* oldHover = m_internals.hover;
-				m_internals.hover = widget;
-				
-				// Call widget events.
-				if (oldHover)
-					oldHover->onMouseLeave(m_internals.mouseX, m_internals.mouseY);
+				int delta = static_cast<int>(children[i]->m_internals.counts[c] - passes[i].counts[c]);
 				
-				widget->onMouseEnter(m_internals.mouseX, m_internals.mouseY);
+				if (delta)
+					this->adjustCount(c, delta);
+			}
+			
+			// Children may have moved under the mouse.
+			m_internals.hoverDirty = true;
+			
+			if (passes[i].boundsChanged)
+			{
+				if (m_internals.index)
+					m_internals.index->update(children[i]);
 				
-				break;
+				m_internals.widgets.updateBounds(children[i]);
+			}
+			
+			if (passes[i].extentChanged)
+				children[i]->extentChanged();
+			
+			if (passes[i].damageAll)
+				this->invalidateAll();
+			
+			for (size_t r = 0, rsz = passes[i].damage.size(); r < rsz; ++r)
+				this->getRoot()->invalidateScreenRect(passes[i].damage[r]);
+		}
+	}
+	
+	static void runParallelTask(void* ctx, size_t i)
+	{
+		ParallelTask& task = *static_cast<ParallelTask*>(ctx);
+		
+		UpdatePass* saved = currentPass();
+		currentPass() = &task.passes[i];
+		
+#if defined(WIDGET_ENABLE_STATS)
+		// Stats are not thread-safe, so parallel subtrees aren't counted.
+		Stats* savedStats = activeStats();
+		activeStats() = NULL;
+#endif
+		
+		task.children[i]->updateTree(task.dt);
+		
+#if defined(WIDGET_ENABLE_STATS)
+		activeStats() = savedStats;
+#endif
+		
+		currentPass() = saved;
+	}
+	
+	// Does this widget want onUpdate() this frame?
+	bool isAwake() const
+	{
+		return !m_internals.sleeping || m_internals.wakePending;
+	}
+	
+	// Call onUpdate() if this widget is awake (or its scheduled update is due.)
+	// A sleeping widget still keeps its hover and children up to date, without calling into its subclass.
+	void updateTree(double dt)
+	{
+		bool wake = this->isAwake();
+		
+		if (m_internals.scheduled)
+		{
+			m_internals.wakeDelay -= dt;
+			
+			if (m_internals.wakeDelay <= 0.)
+			{
+				m_internals.scheduled = false;
+				this->adjustCount(COUNT_SCHEDULED, -1);
+				wake = true;
 			}
 		}
 		
-		// If not hovering over anything, leave old hover widget (if any.)
-		if (!hovering && this->m_internals.hover)
+		// Clear the wake-up first, so onUpdate() can ask for another one.
+		if (m_internals.wakePending)
 		{
-			m_internals.hover->onMouseLeave(m_internals.mouseX, m_internals.mouseY);
-			m_internals.hover = NULL;
+			m_internals.wakePending = false;
+			
+			if (m_internals.sleeping)
+				this->adjustCount(COUNT_AWAKE, -1);
 		}
 		
-		// Update all children.
-		for (size_t i = 0, sz = m_internals.widgets.size(); i < sz; ++i)
-			m_internals.widgets[i]->onUpdate(dt);
+		WIDGET_STATS_TIME(this, EVENT_UPDATE);
+		
+		if (wake)
+			this->onUpdate(dt);
+		else
+			this->BasicWidget::onUpdate(dt);
 	}
 	
-	// When the widget is supposed to be rendered.
-	// NOTE: Inherited classes should invoke this method for the super-class.
-	virtual void onDraw(double scrx, double scry, void* udata = NULL)
+#if defined(WIDGET_ENABLE_STATS)
+	void resetSubtreeTimes()
 	{
-		if (m_internals.hidden)
-			return;
+		m_internals.updateTime = 0.;
+		m_internals.drawTime = 0.;
 		
-		Widget* widget;
-		
-		// Draw all children.
 		for (size_t i = 0, sz = m_internals.widgets.size(); i < sz; ++i)
 		{
-			widget = m_internals.widgets[i];
-			
-			if (!widget->m_internals.hidden)
-				widget->onDraw(widget->x + scrx, widget->y + scry, udata);
+			if (m_internals.widgets[i])
+				m_internals.widgets[i]->resetSubtreeTimes();
 		}
 	}
+#endif
 	
-	// When a mouse button is down.
-	// NOTE: Inherited classes should invoke this method for the super-class.
-	virtual void onMouseDown(double x, double y, unsigned int b)
+	// Call a widget's onDraw(), timing it when collecting stats.
+	static void callDraw(BasicWidget* widget, T scrx, T scry, void* udata)
 	{
-		if (m_internals.hidden)
-			return;
+		WIDGET_STATS_TIME(widget, EVENT_DRAW);
+		widget->onDraw(scrx, scry, udata);
+	}
+	
+	// Queue a raw input event, merging it into the last queued event if the coalescing flags allow.
+	void queueInput(typename InputEvent::Type type, double time, T x, T y, T dx, T dy, int value, unsigned int button)
+	{
+		TreeState& tree = this->getTreeState();
 		
-		Widget* widget;
+		InputEvent event;
+		event.type = type;
+		event.time = time;
+		event.x = x;
+		event.y = y;
+		event.dx = dx;
+		event.dy = dy;
+		event.value = value;
+		event.button = button;
+		event.first = tree.inputHistory.size();
+		event.count = 1;
 		
-		m_internals.mouseInsideChild = false;
+		if (tree.listener)
+			tree.listener->onInput(event, true);
 		
-		// Send mouse-down signal to all children.
-		for (size_t i = m_internals.widgets.size(); i--;)
-		{
-			widget = m_internals.widgets[i];
-			widget->onMouseDown(x - widget->x, y - widget->y, b);
-		}
+		tree.inputHistory.push_back(event);
 		
-		// If the mouse is inside this widget.
-		if (x >= 0. && x < this->width &&
-			y >= 0. && y < this->height )
+		if (!tree.input.empty() && tree.input.back().type == type)
 		{
+			InputEvent& last = tree.input.back();
 			
-			// Check for any mouse-downs inside of a child widget.
-			// When found, push to the back, making it the focused widget.
-			for (size_t i = m_internals.widgets.size(); i--;)
+			if (type == InputEvent::MOUSE_MOVE && (tree.coalescing & COALESCE_MOUSE_MOVE))
 			{
-				widget = m_internals.widgets[i];
-				
-				if (widget->m_internals.hidden)
-					continue;
-				
-				if (x >= widget->x && x < widget->x + widget->width &&
-					y >= widget->y && y < widget->y + widget->height )
-				{
-					m_internals.mouseInsideChild = true;
-					
-					// Widget is being held down.
-					if (!widget->m_internals.down)
-					{
-						widget->m_internals.down = true;
-						widget->m_internals.downBtn = b;
-					}
-					
-					// Make this widget the focused child.
-					this->setFocus(i);
-					
-					if (!widget->m_internals.mouseInsideChild)
-					{
-						// Mouse pressed.
-						widget->onPress(x - widget->x,  y - widget->y, b);
-					}
-					
-					break;
-				}
+				last.x = x;
+				last.y = y;
+				last.dx += dx;
+				last.dy += dy;
+				last.time = time;
+				++last.count;
+				return;
 			}
 			
+			if (type == InputEvent::MOUSE_WHEEL && (tree.coalescing & COALESCE_MOUSE_WHEEL) && last.x == x && last.y == y)
+			{
+				last.value += value;
+				last.time = time;
+				++last.count;
+				return;
+			}
 		}
+		
+		tree.input.push_back(event);
 	}
 	
-	// When a mouse button is up.
-	// NOTE: Inherited classes should invoke this method for the super-class.
-	virtual void onMouseUp(double x, double y, unsigned int b)
+	// Tell the tree's input listener about an event given directly to this widget.
+	// Events dispatched by processInput() were already reported when they were queued.
+	void notifyInput(typename InputEvent::Type type, T x, T y, T dx, T dy, int value, unsigned int button)
 	{
-		if (m_internals.hidden)
+		if (!m_internals.tree || !m_internals.tree->listener || m_internals.tree->currentInput)
 			return;
 		
-		Widget* widget;
-		
-		m_internals.mouseInsideChild = false;
-		
-		// Send mouse-up signal to all children.
-		for (size_t i = m_internals.widgets.size(); i--;)
-		{
-			widget = m_internals.widgets[i];
-			widget->onMouseUp(x - widget->x, y - widget->y, b);
-		}
+		InputEvent event;
+		event.type = type;
+		event.time = 0.;
+		event.x = x;
+		event.y = y;
+		event.dx = dx;
+		event.dy = dy;
+		event.value = value;
+		event.button = button;
+		event.first = 0;
+		event.count = 1;
 		
-		bool mouseInsideThis = ( x >= 0. && x < this->width && y >= 0. && y < this->height );
+		m_internals.tree->listener->onInput(event, false);
+	}
+	
+	// Get the area covered by the visible children (and their children), relative to this widget. Empty without any, or
+	// when the children are clipped. Cached until it changes. (See forgetChildExtent().)
+	Rect getChildExtent()
+	{
+		if (m_internals.clipChildren)
+			return Rect();
 		
-		// Check for any mouse-ups inside of a child widget.
-		for (size_t i = m_internals.widgets.size(); i--;)
+		if (!m_internals.childExtentValid)
 		{
-			widget = m_internals.widgets[i];
+			Rect extent;
 			
-			if (!m_internals.mouseInsideChild)
+			for (size_t i = 0, sz = m_internals.widgets.size(); i < sz; ++i)
 			{
-				m_internals.mouseInsideChild = (
-					x >= widget->x && x < widget->x + widget->width &&
-					y >= widget->y && y < widget->y + widget->height );
-			}
-			
-			if (widget->m_internals.down && widget->m_internals.downBtn == b)
-			{
-				// No longer held down.
-				widget->m_internals.down = false;
+				BasicWidget* widget = m_internals.widgets[i];
 				
-				if (widget->m_internals.hidden)
+				if (!widget || widget->m_internals.hidden)
 					continue;
 				
-				// Mouse released this widget.
-				widget->onRelease(x - widget->x, y - widget->y, b);
-					
-				if (mouseInsideThis && !widget->m_internals.mouseInsideChild)
-				{
-					// Check if mouse was inside.
-					if (x >= widget->x && x < widget->x + widget->width &&
-						y >= widget->y && y < widget->y + widget->height )
-					{
-						// Widget was clicked.
-						widget->onClick(x - widget->x, y - widget->y, b);
-					}
-				}
+				Rect inner = widget->getChildExtent();
+				inner.x += widget->x;
+				inner.y += widget->y;
+				
+				extent.add(Rect(widget->x, widget->y, widget->width, widget->height));
+				extent.add(inner);
 			}
+			
+			m_internals.childExtent = extent;
+			m_internals.childExtentValid = true;
 		}
+		
+		return m_internals.childExtent;
 	}
 	
-	// When the mouse wheel moves.
-	// NOTE: Inherited classes should invoke this method for the super-class.
-	virtual void onMouseWheel(double x, double y, int d)
+	// The children of this widget changed: forget the cached extent of its children, and of the parents it is part of.
+	// Stops at the first one already forgotten, since its parents were forgotten along with it. Inside a parallel update,
+	// the parents of the subtree are left to updateParallel().
+	void forgetChildExtent()
 	{
-		Widget* widget;
+		UpdatePass* pass = currentPass();
 		
-		// Send mouse-wheel signal to all children.
-		for (size_t i = 0, sz = m_internals.widgets.size(); i < sz; ++i)
+		for (BasicWidget* cur = this; cur && cur->m_internals.childExtentValid; cur = cur->m_internals.parent)
 		{
-			widget = m_internals.widgets[i];
-			widget->onMouseWheel(x - widget->x, y - widget->y, d);
+			cur->m_internals.childExtentValid = false;
+			
+			// The parents don't see past widgets clipping their children.
+			if (cur->m_internals.clipChildren)
+				break;
+			
+			if (pass && pass->top == cur)
+			{
+				pass->extentChanged = true;
+				break;
+			}
 		}
 	}
 	
-	// When the mouse moves.
-	// NOTE: Inherited classes should invoke this method for the super-class.
-	virtual void onMouseMove(double x, double y, double dx, double dy)
+	// This widget moved, resized, was hidden or shown, or started or stopped clipping its children: its parent's children
+	// changed.
+	void extentChanged()
 	{
-		Widget* widget;
-		
-		// Update mouse positions.
-		m_internals.mouseX = x;
-		m_internals.mouseY = y;
+		UpdatePass* pass = currentPass();
 		
-		// Send mouse-move signal to all children.
-		for (size_t i = 0, sz = m_internals.widgets.size(); i < sz; ++i)
-		{
-			widget = m_internals.widgets[i];
-			widget->onMouseMove(x - widget->x, y - widget->y, dx, dy);
-		}
+		if (pass && pass->top == this)
+			pass->extentChanged = true;
+		else if (m_internals.parent)
+			m_internals.parent->forgetChildExtent();
 	}
 	
-	// When a keyboard key is down.
-	// NOTE: Inherited classes should invoke this method for the super-class.
-	virtual void onKeyDown(int key)
+	// Does this widget draw its whole subtree within its own bounds? Only known for widgets clipping their children,
+	// or without any. Other subtrees can't be skipped as a whole, their children are culled one by one.
+	bool isContained() const
 	{
-		// Send key-down signal to all children.
-		for (size_t i = 0, sz = m_internals.widgets.size(); i < sz; ++i)
-			m_internals.widgets[i]->onKeyDown(key);
+		return m_internals.clipChildren || m_internals.widgets.empty();
 	}
 	
-	// When a keyboard key is up.
-	// NOTE: Inherited classes should invoke this method for the super-class.
-	virtual void onKeyUp(int key)
+	// Get the root's tree state, allocating it if needed.
+	TreeState& getTreeState()
 	{
-		// Send key-up signal to all children.
-		for (size_t i = 0, sz = m_internals.widgets.size(); i < sz; ++i)
-			m_internals.widgets[i]->onKeyUp(key);
+		if (!m_internals.tree)
+			m_internals.tree = new TreeState();
+		
+		return *m_internals.tree;
 	}
 	
-	// When a character is entered. (Useful for widgets like textboxes)
-	// NOTE: Inherited classes should invoke this method for the super-class.
-	virtual void onKeyText(unsigned int ch)
+	// Mark an area (in screen coordinates) of the root's tree as needing to be redrawn.
+	void invalidateScreenRect(const Rect& rect)
 	{
-		// Send text signal to all children.
-		for (size_t i = 0, sz = m_internals.widgets.size(); i < sz; ++i)
-			m_internals.widgets[i]->onKeyText(ch);
+		if (!m_internals.tree)
+			return;
+		
+		++m_internals.tree->changes;
+		
+		if (this->isDamageTracking() && !rect.isEmpty())
+			this->addDamage(rect);
 	}
 	
-	
-	// When this widget has moved.
-	virtual void onMove(double dx, double dy)
+	// Add a rectangle (in screen coordinates) to the damage list, merging it with any damage it touches.
+	void addDamage(Rect rect)
 	{
+		TreeState& tree = *m_internals.tree;
+		
+		if (tree.fullDamage)
+			return;
+		
+		std::vector<Rect>& damage = tree.damage;
+		
+		for (size_t i = damage.size(); i--;)
+		{
+			if (damage[i].touches(rect))
+			{
+				// Merge and start over, the bigger rectangle may now touch others.
+				rect.merge(damage[i]);
+				damage[i] = damage.back();
+				damage.pop_back();
+				i = damage.size();
+			}
+		}
+		
+		// Keep the list short, collapse it into one rectangle once it grows too long.
+		if (damage.size() >= MAX_DAMAGE_RECTS)
+		{
+			for (size_t i = 0, sz = damage.size(); i < sz; ++i)
+				rect.merge(damage[i]);
+			
+			damage.clear();
+		}
 		
+		damage.push_back(rect);
 	}
 	
-	// When the widget is resized.
-	virtual void onResize()
+	// Draw this root widget with `ctx', clipped to the viewport.
+	void drawRoot(DrawContext& ctx, void* udata)
 	{
+		ctx.clipped = this->hasViewport();
+		
+		if (ctx.clipped)
+		{
+			ctx.clip = m_internals.tree->viewport;
+			
+			if (this->isContained() && !ctx.clip.intersects(Rect(this->x, this->y, width, height)))
+				return;
+		}
 		
+		m_internals.drawCtx = &ctx;
+		callDraw(this, this->x, this->y, udata);
+		m_internals.drawCtx = NULL;
 	}
 	
-	// When the mouse presses inside this widget.
-	virtual void onPress(double x, double y, unsigned int b)
+	// Does the rectangle (in screen coordinates) touch any damage?
+	static bool isDamaged(const DrawContext& ctx, const Rect& rect)
 	{
+		for (size_t i = 0; i < ctx.numDamage; ++i)
+		{
+			if (ctx.damage[i].intersects(rect))
+				return true;
+		}
 		
+		return false;
 	}
 	
-	// When the mouse releases.
-	virtual void onRelease(double x, double y, unsigned int b)
+	// Pass a mouse move on to a child, converting the position to be relative to the child.
+	void sendMouseMove(BasicWidget* child, T x, T y, T dx, T dy)
 	{
-		
+		child->m_internals.moveStamp = m_internals.moveStamp;
+		child->onMouseMove(x - child->x, y - child->y, dx, dy);
 	}
 	
-	// When the mouse clicks this widget. (Useful for widgets like buttons)
-	// (When the mouse has pressed this widget and released with the mouse inside.)
-	virtual void onClick(double x, double y, unsigned int b)
+	// Set whether this widget is held down, keeping the held-down subtree counters up to date.
+	void setHeldDown(bool down, unsigned int b)
 	{
+		if (down != m_internals.down)
+		{
+			PendingPress& pending = pendingPress();
+			
+			if (pending.active)
+			{
+				// Take over the changes made below this widget, its parents get them all at once.
+				if (pending.from != this)
+					flushPressed();
+				
+				pending.delta += down ? 1 : -1;
+				pending.from = m_internals.parent;
+				m_internals.counts[COUNT_PRESSED] += pending.delta;
+			}
+			else
+			{
+				this->adjustCount(COUNT_PRESSED, down ? 1 : -1);
+			}
+			
+			// Remember the press for DISPATCH_CAPTURED_MOUSE_UP.
+			TreeState* captureTree = currentCaptureTree();
+			
+			if (down && captureTree)
+			{
+				Capture capture;
+				capture.widget = this;
+				capture.button = b;
+				capture.pointer = false;
+				
+				captureTree->captures.push_back(capture);
+			}
+		}
+		
+		m_internals.down = down;
 		
+		if (down)
+			m_internals.downBtn = b;
 	}
 	
-	// When the user focuses on this widget.
-	virtual void onFocusGained()
+	// Held-down counter changes still to be added up the tree. (See PendingPress.)
+	static PendingPress& pendingPress()
 	{
+		static thread_local PendingPress pending = { false, NULL, 0 };
+		return pending;
+	}
+	
+	// Add the pending held-down counter changes to the rest of the path.
+	static void flushPressed()
+	{
+		PendingPress& pending = pendingPress();
+		
+		if (pending.from && pending.delta)
+			pending.from->adjustCount(COUNT_PRESSED, pending.delta);
 		
+		pending.from = NULL;
+		pending.delta = 0;
 	}
 	
-	// When the user defocuses from this widget.
-	virtual void onFocusLost()
+	// Tree whose captures are being recorded or followed by the mouse event being sent. NULL if none.
+	static TreeState*& currentCaptureTree()
+	{
+		static thread_local TreeState* tree = NULL;
+		return tree;
+	}
+	
+	// Work out the paths from this widget to the widgets held down by button `b', and to the widgets capturing the pointer.
+	void findReleasePaths(TreeState& tree, unsigned int b)
 	{
+		tree.release.clear();
+		
+		for (size_t i = 0, sz = tree.captures.size(); i < sz; ++i)
+		{
+			const Capture& capture = tree.captures[i];
+			
+			if (!capture.pointer && (capture.button != b || !capture.widget->m_internals.down))
+				continue;
+			
+			// Walk up until joining a path found earlier. Only captures below this widget count.
+			size_t pathStart = tree.release.size();
+			BasicWidget* cur = capture.widget;
+			
+			while (cur != this && !cur->m_internals.onReleasePath && cur->m_internals.parent)
+			{
+				CaptureEdge edge;
+				edge.parent = cur->m_internals.parent;
+				edge.child = cur;
+				tree.release.push_back(edge);
+				
+				cur->m_internals.onReleasePath = true;
+				cur = cur->m_internals.parent;
+			}
+			
+			if (cur != this && !cur->m_internals.onReleasePath)
+			{
+				for (size_t e = pathStart, esz = tree.release.size(); e < esz; ++e)
+					tree.release[e].child->m_internals.onReleasePath = false;
+				
+				tree.release.resize(pathStart);
+			}
+		}
+		
+		for (size_t i = 0, sz = tree.release.size(); i < sz; ++i)
+			tree.release[i].child->m_internals.onReleasePath = false;
 		
+		std::sort(tree.release.begin(), tree.release.end());
 	}
 	
-	// When the mouse entered inside the widget.
-	virtual void onMouseEnter(double x, double y)
+	static bool edgeParentLess(const CaptureEdge& edge, const BasicWidget* parent)
+	{
+		return edge.parent < parent;
+	}
+	
+	// Get the children a mouse up is sent to: edges [first, last) while following captures, or all children (returning NULL) otherwise.
+	const CaptureEdge* getReleaseEdges(size_t& first, size_t& last) const
 	{
+		TreeState* tree = currentCaptureTree();
+		
+		if (!tree || !(m_internals.dispatch & DISPATCH_CAPTURED_MOUSE_UP))
+			return NULL;
+		
+		const CaptureEdge* edges = tree->release.empty() ? NULL : &tree->release[0];
+		const CaptureEdge* end = edges + tree->release.size();
+		const CaptureEdge* begin = std::lower_bound(edges, end, this, &BasicWidget::edgeParentLess);
+		
+		first = begin - edges;
+		last = first;
 		
+		while (last < tree->release.size() && edges[last].parent == this)
+			++last;
+		
+		// Without any edges, the range is empty.
+		return edges;
 	}
 	
-	// When the mouse left outside the widget.
-	virtual void onMouseLeave(double x, double y)
+	// This subtree is leaving its tree. Held-down and capturing widgets in it (or only below this widget, without `self') are
+	// released quietly, since the tree would never send them their mouse up.
+	void dropCaptures(bool self)
 	{
+		flushPressed();
+		
+		unsigned int held = m_internals.counts[COUNT_PRESSED] + m_internals.counts[COUNT_CAPTURING];
+		
+		if (!self)
+			held -= (m_internals.down ? 1 : 0) + (m_internals.captured ? 1 : 0);
+		
+		if (!held)
+			return;
+		
+		BasicWidget* root = this->getRoot();
+		
+		if (!root->m_internals.tree)
+			return;
+		
+		std::vector<Capture>& captures = root->m_internals.tree->captures;
+		
+		// These are not released along a single path, so the counters are adjusted right away.
+		PendingPress& pending = pendingPress();
+		bool wasActive = pending.active;
+		pending.active = false;
+		
+		for (size_t i = captures.size(); i--;)
+		{
+			BasicWidget* widget = captures[i].widget;
+			BasicWidget* cur = widget;
+			
+			if (!self && cur == this)
+				continue;
+			
+			while (cur && cur != this)
+				cur = cur->m_internals.parent;
+			
+			if (!cur)
+				continue;
+			
+			if (captures[i].pointer)
+			{
+				widget->m_internals.captured = false;
+				widget->adjustCount(COUNT_CAPTURING, -1);
+			}
+			else if (widget->m_internals.down)
+			{
+				widget->setHeldDown(false, widget->m_internals.downBtn);
+			}
+			
+			captures.erase(captures.begin() + i);
+		}
 		
+		pending.active = wasActive;
 	}
 	
-	// When this widget adopts a child widget.
-	virtual void onAdopt(Widget& child)
+	// A former root joined this tree. Presses and captures it recorded while it was a root move over to this tree, so mouse ups
+	// sent to this tree still find them.
+	void takeCaptures(BasicWidget* widget)
 	{
+		TreeState* own = widget->m_internals.tree;
+		
+		if (!own || own->captures.empty())
+			return;
 		
+		std::vector<Capture>& captures = this->getRoot()->getTreeState().captures;
+		captures.insert(captures.end(), own->captures.begin(), own->captures.end());
+		own->captures.clear();
 	}
 	
-	// When this widget disowns a child widget.
-	virtual void onDisown(Widget& child)
+	// Add to a subtree counter of this widget and all its parents.
+	void adjustCount(int counter, int delta)
 	{
+		// A parallel update only owns its subtree. The parents are adjusted after the join, see updateParallel().
+		UpdatePass* pass = currentPass();
+		BasicWidget* top = pass ? pass->top : NULL;
 		
+		for (BasicWidget* cur = this; cur; cur = cur->m_internals.parent)
+		{
+			cur->m_internals.counts[counter] += delta;
+			
+			if (cur == top)
+				break;
+		}
 	}
 	
-	// When this widget has been adopted.
-	virtual void onAdopted(Widget& parent)
+	// Move a child to the top of this widget's z-order.
+	void raiseZOrder(BasicWidget* child)
 	{
+		// Renumber all children once the counter runs out.
+		if (m_internals.zcounter == UINT_MAX)
+			this->renumberZOrder();
+		
+		child->m_internals.zorder = ++m_internals.zcounter;
 		
+		// The raised child may now be the one under the mouse.
+		m_internals.hoverDirty = true;
+		this->geometryChanged();
 	}
 	
-	// When this widget has been disowned.
-	virtual void onDisowned(Widget& parent)
+	// Number the children's z-orders from 1 again. Relative order is preserved.
+	void renumberZOrder()
 	{
+		m_internals.zcounter = 0;
 		
+		for (size_t i = 0, sz = m_internals.widgets.size(); i < sz; ++i)
+		{
+			if (m_internals.widgets[i])
+				m_internals.widgets[i]->m_internals.zorder = ++m_internals.zcounter;
+		}
 	}
 	
+	// Widgets are not copyable.
+	BasicWidget(const BasicWidget&);
+	BasicWidget& operator=(const BasicWidget&);
+	
 };
 
+typedef BasicWidget<double> Widget;
+
 #endif
\ No newline at end of file
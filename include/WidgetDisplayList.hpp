@@ -0,0 +1,267 @@
+/* * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * *
+ *  WidgetDisplayList.hpp                                                            *
+ *  Recorded, state-sorted draw commands for the Widget system.                      *
+ *                                                                                   *
+ * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * *
+ *                                                                                   *
+ *      Copyright © 2013 Nathan Cousins                                              *
+ *                                                                                   *
+ *  Permission is hereby granted, free of charge, to any person obtaining a copy     *
+ *  of this software and associated documentation files (the “Software”), to deal    *
+ *  in the Software without restriction, including without limitation the rights     *
+ *  to use, copy, modify, merge, publish, distribute, sublicense, and/or sell        *
+ *  copies of the Software, and to permit persons to whom the Software is            *
+ *  furnished to do so, subject to the following conditions:                         *
+ *                                                                                   *
+ *  The above copyright notice and this permission notice shall be included in       *
+ *  all copies or substantial portions of the Software.                              *
+ *                                                                                   *
+ *  THE SOFTWARE IS PROVIDED “AS IS”, WITHOUT WARRANTY OF ANY KIND, EXPRESS          *
+ *  OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,      *
+ *  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE      *
+ *  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER           *
+ *  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,    *
+ *  OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN        *
+ *  THE SOFTWARE.                                                                    *
+ *                                                                                   *
+ * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * */
+
+
+#ifndef _WIDGETDISPLAYLIST_HPP_INCLUDED
+#define _WIDGETDISPLAYLIST_HPP_INCLUDED
+
+#include <cstddef>
+#include <cstring>
+#include <algorithm>
+#include <vector>
+
+
+// A list of draw commands recorded by widgets, replayed later in batches.
+// Commands are sorted by key, then merged into batches of consecutive commands sharing the same key and opcode.
+// Payloads live in an arena owned by the list, which is reused when the list is cleared.
+class DisplayList
+{
+public:
+
+	// A recorded draw command.
+	struct Command
+	{
+		unsigned long long key;   /* Sort key. See makeKey(). */
+		unsigned int seq;         /* Recording order, keeps the sort stable. */
+		unsigned int op;          /* Backend-defined opcode. */
+		const void* data;         /* Payload, stored in the list's arena. */
+		size_t size;              /* Payload size in bytes. */
+	};
+
+	// A run of commands sharing the same key and opcode, submitted to the backend in one go.
+	struct Batch
+	{
+		unsigned long long key;
+		unsigned int op;
+		const Command* commands;
+		size_t count;
+	};
+
+	// Receives batches when a list is replayed.
+	class Backend
+	{
+	public:
+		virtual ~Backend()
+		{
+
+		}
+
+		virtual void submit(const Batch& batch, void* udata) = 0;
+	};
+
+	// Build a sort key. Lower layers are replayed first; within a layer commands are grouped by material (texture, shader, ...)
+	// Commands of overlapping widgets that must keep their paint order should be put in different layers.
+	static unsigned long long makeKey(unsigned int layer, unsigned int material)
+	{
+		return (static_cast<unsigned long long>(layer) << 32) | material;
+	}
+
+
+	/* *** Contruction/Deconstruction *** */
+
+	DisplayList()
+		: m_chunk(0), m_used(0), m_finished(false), m_source(NULL), m_version(0)
+	{
+
+	}
+
+	~DisplayList()
+	{
+		for (size_t i = 0, sz = m_chunks.size(); i < sz; ++i)
+			delete[] m_chunks[i];
+	}
+
+
+	/* *** Recording *** */
+
+	// Remove all commands. Arena memory is kept for the next recording.
+	void clear()
+	{
+		m_commands.clear();
+		m_batches.clear();
+		m_chunk = 0;
+		m_used = 0;
+		m_finished = false;
+		m_source = NULL;
+		m_version = 0;
+	}
+
+	// Record a command, returning `size' bytes of payload memory to fill in.
+	void* record(unsigned long long key, unsigned int op, size_t size)
+	{
+		Command cmd;
+		cmd.key = key;
+		cmd.seq = static_cast<unsigned int>(m_commands.size());
+		cmd.op = op;
+		cmd.size = size;
+		cmd.data = size ? this->allocate(size) : NULL;
+
+		m_commands.push_back(cmd);
+		m_finished = false;
+
+		return const_cast<void*>(cmd.data);
+	}
+
+	// Record a command with a copy of `payload'. The payload must be trivially copyable.
+	template <typename T>
+	void record(unsigned long long key, unsigned int op, const T& payload)
+	{
+		std::memcpy(this->record(key, op, sizeof(T)), &payload, sizeof(T));
+	}
+
+	// Sort the commands and build batches. Called automatically before replaying.
+	void finish()
+	{
+		if (m_finished)
+			return;
+
+		std::sort(m_commands.begin(), m_commands.end(), &DisplayList::commandLess);
+
+		m_batches.clear();
+
+		for (size_t i = 0, sz = m_commands.size(); i < sz;)
+		{
+			Batch batch;
+			batch.key = m_commands[i].key;
+			batch.op = m_commands[i].op;
+			batch.commands = &m_commands[i];
+			batch.count = 1;
+
+			while (i + batch.count < sz &&
+				m_commands[i + batch.count].key == batch.key && m_commands[i + batch.count].op == batch.op)
+			{
+				++batch.count;
+			}
+
+			m_batches.push_back(batch);
+			i += batch.count;
+		}
+
+		m_finished = true;
+	}
+
+
+	/* *** Replaying *** */
+
+	// Submit every batch to the backend, in key order.
+	void replay(Backend& backend, void* udata = NULL)
+	{
+		this->finish();
+
+		for (size_t i = 0, sz = m_batches.size(); i < sz; ++i)
+			backend.submit(m_batches[i], udata);
+	}
+
+	// Get the number of recorded commands.
+	size_t getNumOfCommands() const
+	{
+		return m_commands.size();
+	}
+
+	// Get the number of batches. Only valid after finish().
+	size_t getNumOfBatches() const
+	{
+		return m_batches.size();
+	}
+
+
+	/* *** Reuse *** */
+
+	// Remember what this list was recorded from. Used by Widget to reuse lists while its tree is unchanged.
+	void setSource(const void* source, unsigned long version)
+	{
+		m_source = source;
+		m_version = version;
+	}
+
+	// Was this list recorded from `source' at `version'?
+	bool isFrom(const void* source, unsigned long version) const
+	{
+		return m_source != NULL && m_source == source && m_version == version;
+	}
+
+private:
+
+	static const size_t CHUNK_SIZE = 64 * 1024;
+	static const size_t ALIGNMENT = 16;
+
+	std::vector<Command> m_commands;
+	std::vector<Batch> m_batches;
+
+	std::vector<char*> m_chunks;
+	std::vector<size_t> m_chunkSizes;
+	size_t m_chunk;   /* Chunk currently being filled. */
+	size_t m_used;    /* Bytes used in the current chunk. */
+
+	bool m_finished;
+
+	const void* m_source;
+	unsigned long m_version;
+
+	static bool commandLess(const Command& a, const Command& b)
+	{
+		if (a.key != b.key)
+			return a.key < b.key;
+
+		return a.seq < b.seq;
+	}
+
+	// Allocate payload memory from the arena.
+	void* allocate(size_t size)
+	{
+		size = (size + ALIGNMENT - 1) & ~(ALIGNMENT - 1);
+
+		// Move on to the next chunk that can fit the payload, allocating one if needed.
+		while (m_chunk < m_chunks.size() && m_used + size > m_chunkSizes[m_chunk])
+		{
+			++m_chunk;
+			m_used = 0;
+		}
+
+		if (m_chunk == m_chunks.size())
+		{
+			size_t chunkSize = (size > CHUNK_SIZE) ? size : CHUNK_SIZE;
+
+			m_chunks.push_back(new char[chunkSize]);
+			m_chunkSizes.push_back(chunkSize);
+			m_used = 0;
+		}
+
+		void* mem = m_chunks[m_chunk] + m_used;
+		m_used += size;
+
+		return mem;
+	}
+
+	// Display lists are not copyable.
+	DisplayList(const DisplayList&);
+	DisplayList& operator=(const DisplayList&);
+
+};
+
+#endif
@@ -0,0 +1,836 @@
+/* * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * *
+ *  WidgetInputRecorder.hpp                                                          *
+ *  Input recording and replay for the Widget system.                                *
+ *                                                                                   *
+ * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * *
+ *                                                                                   *
+ *      Copyright © 2013 Nathan Cousins                                              *
+ *                                                                                   *
+ *  Permission is hereby granted, free of charge, to any person obtaining a copy     *
+ *  of this software and associated documentation files (the “Software”), to deal    *
+ *  in the Software without restriction, including without limitation the rights     *
+ *  to use, copy, modify, merge, publish, distribute, sublicense, and/or sell        *
+ *  copies of the Software, and to permit persons to whom the Software is            *
+ *  furnished to do so, subject to the following conditions:                         *
+ *                                                                                   *
+ *  The above copyright notice and this permission notice shall be included in       *
+ *  all copies or substantial portions of the Software.                              *
+ *                                                                                   *
+ *  THE SOFTWARE IS PROVIDED “AS IS”, WITHOUT WARRANTY OF ANY KIND, EXPRESS          *
+ *  OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,      *
+ *  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE      *
+ *  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER           *
+ *  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,    *
+ *  OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN        *
+ *  THE SOFTWARE.                                                                    *
+ *                                                                                   *
+ * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * */
+
+
+#ifndef _WIDGETINPUTRECORDER_HPP_INCLUDED
+#define _WIDGETINPUTRECORDER_HPP_INCLUDED
+
+#include "Widget.hpp"
+
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <algorithm>
+#include <vector>
+
+
+// A compact binary log of the input given to a root widget. Recorded with BasicInputRecorder, replayed with BasicInputReplayer.
+// Each record is a tag byte followed by its payload. Whole-number positions and distances are stored as varints,
+// anything else as raw doubles, so a log replays with exactly the values that were recorded.
+class InputLog
+{
+public:
+
+	enum Type
+	{
+		MOUSE_DOWN,
+		MOUSE_UP,
+		MOUSE_WHEEL,
+		MOUSE_MOVE,
+		KEY_DOWN,
+		KEY_UP,
+		KEY_TEXT,
+		UPDATE,
+
+		NUM_TYPES
+	};
+
+	// A recorded call into the root widget.
+	struct Record
+	{
+		Type type;
+		bool queued;              /* Given with queueMouseDown() etc., rather than dispatched right away. */
+		double time;              /* Timestamp of queued input. */
+
+		double x, y;              /* Mouse position. */
+		double dx, dy;            /* Mouse move distance. */
+		int value;                /* Wheel delta, or key. */
+		unsigned int button;      /* Mouse button, or text character. */
+
+		double dt;                /* Update time step. */
+	};
+
+	// Reads the records of a log, in order.
+	class Reader
+	{
+	public:
+
+		Reader(const InputLog& log)
+			: m_log(log), m_pos(0), m_time(0.), m_dt(0.), m_failed(false)
+		{
+
+		}
+
+		// Read the next record. Returns false at the end of the log, or if the log is malformed. (See hasFailed.)
+		bool next(Record& record)
+		{
+			const std::vector<unsigned char>& data = m_log.m_data;
+
+			if (m_failed || m_pos >= data.size())
+				return false;
+
+			unsigned char tag = data[m_pos++];
+
+			record.type = static_cast<Type>(tag & TYPE_MASK);
+			record.queued = (tag & FLAG_QUEUED) != 0;
+			record.time = m_time;
+			record.x = record.y = record.dx = record.dy = 0.;
+			record.value = 0;
+			record.button = 0;
+			record.dt = m_dt;
+
+			bool whole = (tag & FLAG_WHOLE) != 0;
+			bool ok = record.type < NUM_TYPES;
+
+			if (ok && record.queued && !(tag & FLAG_SAME_TIME))
+				ok = this->readDouble(record.time);
+
+			m_time = record.time;
+
+			switch (record.type)
+			{
+			case MOUSE_DOWN:
+			case MOUSE_UP:
+				ok = ok && this->readCoord(whole, record.x) && this->readCoord(whole, record.y) && this->readUnsigned(record.button);
+				break;
+
+			case MOUSE_WHEEL:
+				ok = ok && this->readCoord(whole, record.x) && this->readCoord(whole, record.y) && this->readSigned(record.value);
+				break;
+
+			case MOUSE_MOVE:
+				ok = ok && this->readCoord(whole, record.x) && this->readCoord(whole, record.y) &&
+					this->readCoord(whole, record.dx) && this->readCoord(whole, record.dy);
+				break;
+
+			case KEY_DOWN:
+			case KEY_UP:
+				ok = ok && this->readSigned(record.value);
+				break;
+
+			case KEY_TEXT:
+				ok = ok && this->readUnsigned(record.button);
+				break;
+
+			case UPDATE:
+				if (!(tag & FLAG_SAME_DT))
+					ok = ok && this->readDouble(record.dt);
+				m_dt = record.dt;
+				break;
+
+			default:
+				ok = false;
+				break;
+			}
+
+			m_failed = !ok;
+
+			return ok;
+		}
+
+		// Did reading stop at a malformed record?
+		bool hasFailed() const
+		{
+			return m_failed;
+		}
+
+	private:
+
+		const InputLog& m_log;
+		size_t m_pos;
+		double m_time;            /* Timestamp of the last queued input. */
+		double m_dt;              /* Time step of the last update. */
+		bool m_failed;
+
+		bool readVarint(unsigned long long& v)
+		{
+			const std::vector<unsigned char>& data = m_log.m_data;
+
+			v = 0;
+
+			for (int shift = 0; shift < 64; shift += 7)
+			{
+				if (m_pos >= data.size())
+					return false;
+
+				unsigned char byte = data[m_pos++];
+				v |= static_cast<unsigned long long>(byte & 0x7f) << shift;
+
+				if (!(byte & 0x80))
+					return true;
+			}
+
+			return false;
+		}
+
+		bool readSigned(int& v)
+		{
+			unsigned long long u;
+
+			if (!this->readVarint(u))
+				return false;
+
+			v = static_cast<int>(InputLog::unzigzag(u));
+			return true;
+		}
+
+		bool readUnsigned(unsigned int& v)
+		{
+			unsigned long long u;
+
+			if (!this->readVarint(u))
+				return false;
+
+			v = static_cast<unsigned int>(u);
+			return true;
+		}
+
+		bool readDouble(double& v)
+		{
+			const std::vector<unsigned char>& data = m_log.m_data;
+
+			if (data.size() - m_pos < 8)
+				return false;
+
+			unsigned long long bits = 0;
+
+			for (int i = 0; i < 8; ++i)
+				bits |= static_cast<unsigned long long>(data[m_pos++]) << (i * 8);
+
+			std::memcpy(&v, &bits, sizeof(v));
+			return true;
+		}
+
+		bool readCoord(bool whole, double& v)
+		{
+			if (!whole)
+				return this->readDouble(v);
+
+			unsigned long long u;
+
+			if (!this->readVarint(u))
+				return false;
+
+			v = static_cast<double>(InputLog::unzigzag(u));
+			return true;
+		}
+
+		// Readers are not assignable.
+		Reader& operator=(const Reader&);
+	};
+
+	static const char* getTypeName(Type type)
+	{
+		static const char* const names[NUM_TYPES] = {
+			"mouseDown", "mouseUp", "mouseWheel", "mouseMove", "keyDown", "keyUp", "keyText", "update"
+		};
+
+		return names[type];
+	}
+
+
+	/* *** Contruction/Deconstruction *** */
+
+	InputLog()
+		: m_records(0), m_time(0.), m_dt(0.), m_hasDt(false)
+	{
+
+	}
+
+
+	/* *** Recording *** */
+
+	// Remove all records.
+	void clear()
+	{
+		m_data.clear();
+		m_records = 0;
+		m_time = 0.;
+		m_dt = 0.;
+		m_hasDt = false;
+	}
+
+	// Add a record to the end of the log.
+	void append(const Record& record)
+	{
+		unsigned char tag = static_cast<unsigned char>(record.type);
+		bool whole = false;
+
+		if (record.queued)
+		{
+			tag |= FLAG_QUEUED;
+
+			if (std::memcmp(&record.time, &m_time, sizeof(m_time)) == 0)
+				tag |= FLAG_SAME_TIME;
+		}
+
+		switch (record.type)
+		{
+		case MOUSE_DOWN:
+		case MOUSE_UP:
+		case MOUSE_WHEEL:
+			whole = isWhole(record.x) && isWhole(record.y);
+			break;
+
+		case MOUSE_MOVE:
+			whole = isWhole(record.x) && isWhole(record.y) && isWhole(record.dx) && isWhole(record.dy);
+			break;
+
+		case UPDATE:
+			if (m_hasDt && std::memcmp(&record.dt, &m_dt, sizeof(m_dt)) == 0)
+				tag |= FLAG_SAME_DT;
+			break;
+
+		default:
+			break;
+		}
+
+		if (whole)
+			tag |= FLAG_WHOLE;
+
+		m_data.push_back(tag);
+
+		if (record.queued && !(tag & FLAG_SAME_TIME))
+			this->writeDouble(record.time);
+
+		if (record.queued)
+			m_time = record.time;
+
+		switch (record.type)
+		{
+		case MOUSE_DOWN:
+		case MOUSE_UP:
+			this->writeCoord(whole, record.x);
+			this->writeCoord(whole, record.y);
+			this->writeVarint(record.button);
+			break;
+
+		case MOUSE_WHEEL:
+			this->writeCoord(whole, record.x);
+			this->writeCoord(whole, record.y);
+			this->writeVarint(zigzag(record.value));
+			break;
+
+		case MOUSE_MOVE:
+			this->writeCoord(whole, record.x);
+			this->writeCoord(whole, record.y);
+			this->writeCoord(whole, record.dx);
+			this->writeCoord(whole, record.dy);
+			break;
+
+		case KEY_DOWN:
+		case KEY_UP:
+			this->writeVarint(zigzag(record.value));
+			break;
+
+		case KEY_TEXT:
+			this->writeVarint(record.button);
+			break;
+
+		case UPDATE:
+			if (!(tag & FLAG_SAME_DT))
+				this->writeDouble(record.dt);
+			m_dt = record.dt;
+			m_hasDt = true;
+			break;
+
+		default:
+			break;
+		}
+
+		++m_records;
+	}
+
+	// Get the number of records.
+	size_t getNumOfRecords() const
+	{
+		return m_records;
+	}
+
+	// Get the size of the encoded records, in bytes.
+	size_t getSize() const
+	{
+		return m_data.size();
+	}
+
+
+	/* *** Files *** */
+
+	// Write the log to a file. Returns false if the file couldn't be written.
+	bool save(const char* path) const
+	{
+		FILE* file = std::fopen(path, "wb");
+
+		if (!file)
+			return false;
+
+		unsigned char header[MAGIC_SIZE + 1];
+		std::memcpy(header, getMagic(), MAGIC_SIZE);
+		header[MAGIC_SIZE] = VERSION;
+
+		bool ok = std::fwrite(header, 1, sizeof(header), file) == sizeof(header) &&
+			(m_data.empty() || std::fwrite(&m_data[0], 1, m_data.size(), file) == m_data.size());
+
+		return std::fclose(file) == 0 && ok;
+	}
+
+	// Replace the log with one read from a file. Returns false, leaving the log empty, if it couldn't be read or is malformed.
+	bool load(const char* path)
+	{
+		this->clear();
+
+		FILE* file = std::fopen(path, "rb");
+
+		if (!file)
+			return false;
+
+		unsigned char header[MAGIC_SIZE + 1];
+		bool ok = std::fread(header, 1, sizeof(header), file) == sizeof(header) &&
+			std::memcmp(header, getMagic(), MAGIC_SIZE) == 0 && header[MAGIC_SIZE] == VERSION;
+
+		unsigned char buf[4096];
+		size_t n;
+
+		while (ok && (n = std::fread(buf, 1, sizeof(buf), file)) > 0)
+			m_data.insert(m_data.end(), buf, buf + n);
+
+		ok = ok && !std::ferror(file);
+		std::fclose(file);
+
+		// Count the records, checking that all of them can be read.
+		Reader reader(*this);
+		Record record;
+
+		while (ok && reader.next(record))
+		{
+			++m_records;
+			m_time = record.time;
+			m_dt = record.dt;
+			m_hasDt = m_hasDt || record.type == UPDATE;
+		}
+
+		if (!ok || reader.hasFailed())
+		{
+			this->clear();
+			return false;
+		}
+
+		return true;
+	}
+
+private:
+
+	static const unsigned char TYPE_MASK = 0x0f;
+	static const unsigned char FLAG_QUEUED = 0x10;    /* Queued input, prefixed with its timestamp. */
+	static const unsigned char FLAG_WHOLE = 0x20;     /* Positions and distances stored as varints. */
+	static const unsigned char FLAG_SAME_DT = 0x40;   /* Update with the time step of the last one. */
+	static const unsigned char FLAG_SAME_TIME = 0x80; /* Queued input with the timestamp of the last queued input. */
+
+	static const unsigned char VERSION = 1;
+	static const size_t MAGIC_SIZE = 4;
+
+	// File signature of saved logs, followed by the version.
+	static const char* getMagic()
+	{
+		return "WUIR";
+	}
+
+	std::vector<unsigned char> m_data;
+	size_t m_records;
+
+	double m_time;            /* Timestamp of the last queued input. */
+	double m_dt;              /* Time step of the last update. */
+	bool m_hasDt;
+
+	// Can `v' be stored exactly as a varint?
+	static bool isWhole(double v)
+	{
+		return v == std::floor(v) && std::fabs(v) < 9007199254740992. && !(v == 0. && std::signbit(v));
+	}
+
+	static unsigned long long zigzag(long long v)
+	{
+		return (static_cast<unsigned long long>(v) << 1) ^ static_cast<unsigned long long>(v >> 63);
+	}
+
+	static long long unzigzag(unsigned long long u)
+	{
+		return static_cast<long long>(u >> 1) ^ -static_cast<long long>(u & 1);
+	}
+
+	void writeVarint(unsigned long long v)
+	{
+		while (v >= 0x80)
+		{
+			m_data.push_back(static_cast<unsigned char>(v | 0x80));
+			v >>= 7;
+		}
+
+		m_data.push_back(static_cast<unsigned char>(v));
+	}
+
+	void writeDouble(double v)
+	{
+		unsigned long long bits;
+		std::memcpy(&bits, &v, sizeof(bits));
+
+		for (int i = 0; i < 8; ++i)
+			m_data.push_back(static_cast<unsigned char>(bits >> (i * 8)));
+	}
+
+	void writeCoord(bool whole, double v)
+	{
+		if (whole)
+			this->writeVarint(zigzag(static_cast<long long>(v)));
+		else
+			this->writeDouble(v);
+	}
+
+};
+
+
+
+// Records the input given to a root widget into an InputLog, including the time step of every update.
+// Input queued with queueMouseDown() etc. is recorded as queued, so replaying it merges and dispatches it the same way.
+// The recorder must be stopped (or destroyed) before the root widget is.
+template <typename T>
+class BasicInputRecorder : public BasicWidget<T>::InputListener
+{
+public:
+
+	typedef BasicWidget<T> Widget;
+	typedef typename Widget::InputEvent InputEvent;
+
+
+	/* *** Contruction/Deconstruction *** */
+
+	BasicInputRecorder()
+		: m_root(NULL)
+	{
+
+	}
+
+	virtual ~BasicInputRecorder()
+	{
+		this->stop();
+	}
+
+
+	/* *** Recording *** */
+
+	// Start recording the input given to `root', replacing its input listener. Records are added to the end of the log.
+	void start(Widget& root)
+	{
+		this->stop();
+
+		m_root = &root;
+		m_root->setInputListener(this);
+	}
+
+	// Stop recording.
+	void stop()
+	{
+		if (m_root && m_root->getInputListener() == this)
+			m_root->setInputListener(NULL);
+
+		m_root = NULL;
+	}
+
+	// Is input being recorded?
+	bool isRecording() const
+	{
+		return m_root != NULL;
+	}
+
+	// Get the recorded input.
+	InputLog& getLog()
+	{
+		return m_log;
+	}
+
+	const InputLog& getLog() const
+	{
+		return m_log;
+	}
+
+	virtual void onInput(const InputEvent& event, bool queued)
+	{
+		InputLog::Record record;
+		record.type = static_cast<InputLog::Type>(event.type);
+		record.queued = queued;
+		record.time = event.time;
+		record.x = static_cast<double>(event.x);
+		record.y = static_cast<double>(event.y);
+		record.dx = static_cast<double>(event.dx);
+		record.dy = static_cast<double>(event.dy);
+		record.value = event.value;
+		record.button = event.button;
+		record.dt = 0.;
+
+		m_log.append(record);
+	}
+
+	virtual void onUpdate(double dt)
+	{
+		InputLog::Record record;
+		record.type = InputLog::UPDATE;
+		record.queued = false;
+		record.time = 0.;
+		record.x = record.y = record.dx = record.dy = 0.;
+		record.value = 0;
+		record.button = 0;
+		record.dt = dt;
+
+		m_log.append(record);
+	}
+
+private:
+
+	Widget* m_root;
+	InputLog m_log;
+
+	// Recorders are not copyable.
+	BasicInputRecorder(const BasicInputRecorder&);
+	BasicInputRecorder& operator=(const BasicInputRecorder&);
+
+};
+
+
+// Replays an InputLog into a root widget as fast as possible, without waiting between records, timing every call.
+// The tree should be built the same way as the one the log was recorded from for the replay to be meaningful.
+// The time of queued input is spent in the update that processes it; the queueing itself is timed on its own.
+template <typename T>
+class BasicInputReplayer
+{
+public:
+
+	typedef BasicWidget<T> Widget;
+
+	// Call times of one type of record, in nanoseconds.
+	struct Latency
+	{
+		unsigned long long count;
+		double total;
+		double mean;
+		double p50, p90, p99;
+		double max;
+	};
+
+
+	/* *** Contruction/Deconstruction *** */
+
+	BasicInputReplayer()
+		: m_seconds(0.)
+	{
+		this->reset();
+	}
+
+
+	/* *** Replaying *** */
+
+	// Replay every record of `log' into `root', replacing the results of the last replay.
+	// Returns false if the log is malformed. The records before the malformed one are still replayed.
+	bool replay(Widget& root, const InputLog& log)
+	{
+		typedef std::chrono::steady_clock Clock;
+
+		for (int i = 0; i < InputLog::NUM_TYPES; ++i)
+			m_samples[i].clear();
+
+		InputLog::Reader reader(log);
+		InputLog::Record record;
+
+		Clock::time_point start = Clock::now();
+
+		while (reader.next(record))
+		{
+			Clock::time_point t0 = Clock::now();
+			this->dispatch(root, record);
+			Clock::time_point t1 = Clock::now();
+
+			m_samples[record.type].push_back(std::chrono::duration<double, std::nano>(t1 - t0).count());
+		}
+
+		m_seconds = std::chrono::duration<double>(Clock::now() - start).count();
+
+		this->reset();
+
+		std::vector<double> all;
+
+		for (int i = 0; i < InputLog::NUM_TYPES; ++i)
+		{
+			summarize(m_samples[i], m_latency[i]);
+			all.insert(all.end(), m_samples[i].begin(), m_samples[i].end());
+		}
+
+		summarize(all, m_total);
+
+		return !reader.hasFailed();
+	}
+
+	// Get the call times of one type of record, from the last replay.
+	const Latency& getLatency(InputLog::Type type) const
+	{
+		return m_latency[type];
+	}
+
+	// Get the call times of all records, from the last replay.
+	const Latency& getTotalLatency() const
+	{
+		return m_total;
+	}
+
+	// Get the wall time of the last replay, in seconds.
+	double getSeconds() const
+	{
+		return m_seconds;
+	}
+
+	// Get the number of records replayed per second.
+	double getThroughput() const
+	{
+		return m_seconds > 0. ? m_total.count / m_seconds : 0.;
+	}
+
+	// Print the results of the last replay as a table.
+	void print(FILE* file = stdout) const
+	{
+		std::fprintf(file, "%-12s %10s %12s %12s %12s %12s %12s\n", "record", "count", "mean ns", "p50 ns", "p90 ns", "p99 ns", "max ns");
+
+		for (int i = 0; i < InputLog::NUM_TYPES; ++i)
+		{
+			if (m_latency[i].count)
+				printLatency(file, InputLog::getTypeName(static_cast<InputLog::Type>(i)), m_latency[i]);
+		}
+
+		printLatency(file, "all", m_total);
+
+		std::fprintf(file, "%llu records in %.3f s, %.0f records/s\n", m_total.count, m_seconds, this->getThroughput());
+	}
+
+private:
+
+	std::vector<double> m_samples[InputLog::NUM_TYPES];
+	Latency m_latency[InputLog::NUM_TYPES];
+	Latency m_total;
+	double m_seconds;
+
+	void reset()
+	{
+		Latency none = { 0, 0., 0., 0., 0., 0., 0. };
+
+		for (int i = 0; i < InputLog::NUM_TYPES; ++i)
+			m_latency[i] = none;
+
+		m_total = none;
+	}
+
+	static void dispatch(Widget& root, const InputLog::Record& record)
+	{
+		T x = static_cast<T>(record.x);
+		T y = static_cast<T>(record.y);
+
+		if (record.queued)
+		{
+			switch (record.type)
+			{
+			case InputLog::MOUSE_DOWN:  root.queueMouseDown(x, y, record.button, record.time); break;
+			case InputLog::MOUSE_UP:    root.queueMouseUp(x, y, record.button, record.time); break;
+			case InputLog::MOUSE_WHEEL: root.queueMouseWheel(x, y, record.value, record.time); break;
+			case InputLog::MOUSE_MOVE:  root.queueMouseMove(x, y, static_cast<T>(record.dx), static_cast<T>(record.dy), record.time); break;
+			case InputLog::KEY_DOWN:    root.queueKeyDown(record.value, record.time); break;
+			case InputLog::KEY_UP:      root.queueKeyUp(record.value, record.time); break;
+			case InputLog::KEY_TEXT:    root.queueKeyText(record.button, record.time); break;
+			default: break;
+			}
+
+			return;
+		}
+
+		switch (record.type)
+		{
+		case InputLog::MOUSE_DOWN:  root.mouseDown(x, y, record.button); break;
+		case InputLog::MOUSE_UP:    root.mouseUp(x, y, record.button); break;
+		case InputLog::MOUSE_WHEEL: root.mouseWheel(x, y, record.value); break;
+		case InputLog::MOUSE_MOVE:  root.mouseMove(x, y, static_cast<T>(record.dx), static_cast<T>(record.dy)); break;
+		case InputLog::KEY_DOWN:    root.keyDown(record.value); break;
+		case InputLog::KEY_UP:      root.keyUp(record.value); break;
+		case InputLog::KEY_TEXT:    root.keyText(record.button); break;
+		case InputLog::UPDATE:      root.update(record.dt); break;
+		default: break;
+		}
+	}
+
+	// Work out the latency of a set of samples. Sorts the samples.
+	static void summarize(std::vector<double>& samples, Latency& latency)
+	{
+		latency.count = samples.size();
+
+		if (samples.empty())
+			return;
+
+		std::sort(samples.begin(), samples.end());
+
+		latency.total = 0.;
+
+		for (size_t i = 0, sz = samples.size(); i < sz; ++i)
+			latency.total += samples[i];
+
+		latency.mean = latency.total / samples.size();
+		latency.p50 = percentile(samples, 0.50);
+		latency.p90 = percentile(samples, 0.90);
+		latency.p99 = percentile(samples, 0.99);
+		latency.max = samples.back();
+	}
+
+	// Nearest-rank percentile of sorted samples.
+	static double percentile(const std::vector<double>& sorted, double p)
+	{
+		size_t rank = static_cast<size_t>(std::ceil(p * sorted.size()));
+
+		return sorted[rank ? rank - 1 : 0];
+	}
+
+	static void printLatency(FILE* file, const char* name, const Latency& latency)
+	{
+		std::fprintf(file, "%-12s %10llu %12.1f %12.1f %12.1f %12.1f %12.1f\n", name, latency.count,
+			latency.mean, latency.p50, latency.p90, latency.p99, latency.max);
+	}
+
+	// Replayers are not copyable.
+	BasicInputReplayer(const BasicInputReplayer&);
+	BasicInputReplayer& operator=(const BasicInputReplayer&);
+
+};
+
+
+typedef BasicInputRecorder<double> InputRecorder;
+typedef BasicInputReplayer<double> InputReplayer;
+
+#endif
@@ -0,0 +1,589 @@
+/* * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * *
+ *  WidgetLayout.hpp                                                                 *
+ *  Stack, flex and grid layout containers for the Widget system.                    *
+ *                                                                                   *
+ * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * *
+ *                                                                                   *
+ *      Copyright © 2013 Nathan Cousins                                              *
+ *                                                                                   *
+ *  Permission is hereby granted, free of charge, to any person obtaining a copy     *
+ *  of this software and associated documentation files (the “Software”), to deal    *
+ *  in the Software without restriction, including without limitation the rights     *
+ *  to use, copy, modify, merge, publish, distribute, sublicense, and/or sell        *
+ *  copies of the Software, and to permit persons to whom the Software is            *
+ *  furnished to do so, subject to the following conditions:                         *
+ *                                                                                   *
+ *  The above copyright notice and this permission notice shall be included in       *
+ *  all copies or substantial portions of the Software.                              *
+ *                                                                                   *
+ *  THE SOFTWARE IS PROVIDED “AS IS”, WITHOUT WARRANTY OF ANY KIND, EXPRESS          *
+ *  OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,      *
+ *  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE      *
+ *  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER           *
+ *  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,    *
+ *  OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN        *
+ *  THE SOFTWARE.                                                                    *
+ *                                                                                   *
+ * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * */
+
+
+#ifndef _WIDGETLAYOUT_HPP_INCLUDED
+#define _WIDGETLAYOUT_HPP_INCLUDED
+
+#include "Widget.hpp"
+
+#include <vector>
+
+
+// Base of the layout containers. A layout positions and sizes its children, in the order they were added.
+// Each child has a preferred size: its own size when it was added (or last resized by anyone but the layout),
+// or its measured size if it is a layout itself. setItemSize() overrides it.
+// Changes only mark the layout, and the layouts above it, dirty. Dirty layouts are laid out once, on the next update,
+// from the top down, and children are only moved or resized when their place actually changed.
+template <typename T>
+class BasicLayout : public BasicWidget<T>
+{
+public:
+
+	typedef BasicWidget<T> Base;
+
+
+	/* *** Contruction/Deconstruction *** */
+
+	BasicLayout()
+		: m_padding(T(0)), m_spacing(T(0)), m_measuredWidth(T(0)), m_measuredHeight(T(0)),
+		  m_measureDirty(true), m_layoutDirty(true), m_applying(false)
+	{
+
+	}
+
+	virtual ~BasicLayout()
+	{
+
+	}
+
+
+	/* *** Layout properties *** */
+
+	// Set the space between the layout's edges and its children.
+	void setPadding(T padding)
+	{
+		m_padding = padding;
+		this->invalidateLayout();
+	}
+
+	T getPadding() const
+	{
+		return m_padding;
+	}
+
+	// Set the space between neighbouring children.
+	void setSpacing(T spacing)
+	{
+		m_spacing = spacing;
+		this->invalidateLayout();
+	}
+
+	T getSpacing() const
+	{
+		return m_spacing;
+	}
+
+	// Override the preferred size of a child.
+	void setItemSize(const Base* child, T width, T height)
+	{
+		Item* item = this->findItem(child);
+
+		if (!item)
+			return;
+
+		item->width = width;
+		item->height = height;
+		this->invalidateLayout();
+	}
+
+
+	/* *** Layout *** */
+
+	// Get the size this layout would like to have, measuring it first if anything changed.
+	void getMeasuredSize(T& out_width, T& out_height)
+	{
+		if (m_measureDirty)
+		{
+			this->syncItems();
+			this->measure(m_measuredWidth, m_measuredHeight);
+			m_measureDirty = false;
+		}
+
+		out_width = m_measuredWidth;
+		out_height = m_measuredHeight;
+	}
+
+	// Mark this layout as needing to be measured and laid out again, along with the layouts above it.
+	void invalidateLayout()
+	{
+		for (BasicLayout* layout = this; layout; layout = layout->getParentLayout())
+		{
+			// Everything above is already dirty.
+			if (layout->m_measureDirty && layout->m_layoutDirty)
+				break;
+
+			layout->m_measureDirty = true;
+			layout->markLayoutDirty();
+		}
+	}
+
+	// Is this layout waiting to be laid out?
+	bool isLayoutDirty() const
+	{
+		return m_layoutDirty;
+	}
+
+	// Lay out the children now if anything changed, instead of waiting for the next update.
+	// Layouts below are laid out by their own updates.
+	void applyLayout()
+	{
+		if (!m_layoutDirty)
+			return;
+
+		m_layoutDirty = false;
+
+		this->syncItems();
+
+		m_applying = true;
+		this->arrange();
+		m_applying = false;
+	}
+
+protected:
+
+	// A child, with its preferred size.
+	struct Item
+	{
+		Base* widget;
+		BasicLayout* layout;      /* The child as a layout, or NULL if it isn't one. */
+		T width, height;
+		float grow;               /* Share of the left-over space. (Flex layouts.) */
+	};
+
+	std::vector<Item> m_items;
+	T m_padding;
+	T m_spacing;
+
+	// Work out the preferred size of this layout from its items.
+	virtual void measure(T& out_width, T& out_height) = 0;
+
+	// Position and size the items within this layout.
+	virtual void arrange() = 0;
+
+	// Get the preferred size of an item.
+	static void getItemSize(Item& item, T& out_width, T& out_height)
+	{
+		if (item.layout)
+		{
+			item.layout->getMeasuredSize(out_width, out_height);
+			return;
+		}
+
+		out_width = item.width;
+		out_height = item.height;
+	}
+
+	// Give an item its place. Events are only sent for what actually changed.
+	static void place(Item& item, T x, T y, T width, T height)
+	{
+		if (item.widget->getPositionX() != x || item.widget->getPositionY() != y)
+			item.widget->setPosition(x, y);
+
+		if (item.widget->getWidth() != width || item.widget->getHeight() != height)
+			item.widget->setSize(width, height);
+	}
+
+
+	/* *** Widget events *** */
+
+	virtual void onUpdate(double dt)
+	{
+		this->applyLayout();
+		Base::onUpdate(dt);
+	}
+
+	virtual void onResize()
+	{
+		// Our own size doesn't change what we measure, only where the children go.
+		if (!m_layoutDirty)
+			this->markLayoutDirty();
+
+		Base::onResize();
+	}
+
+	virtual void onAdopt(Base& child)
+	{
+		Item item;
+		item.widget = &child;
+		item.layout = dynamic_cast<BasicLayout*>(&child);
+		item.width = child.getWidth();
+		item.height = child.getHeight();
+		item.grow = 0.f;
+
+		m_items.push_back(item);
+		this->invalidateLayout();
+
+		Base::onAdopt(child);
+	}
+
+	virtual void onDisown(Base& child)
+	{
+		for (size_t i = 0, sz = m_items.size(); i < sz; ++i)
+		{
+			if (m_items[i].widget == &child)
+			{
+				m_items.erase(m_items.begin() + i);
+				this->invalidateLayout();
+				break;
+			}
+		}
+
+		Base::onDisown(child);
+	}
+
+	virtual void onChildResize(Base& child)
+	{
+		// Sizes we hand out ourselves don't change the preferred size.
+		if (!m_applying)
+		{
+			Item* item = this->findItem(&child);
+
+			if (item && !item->layout)
+			{
+				item->width = child.getWidth();
+				item->height = child.getHeight();
+				this->invalidateLayout();
+			}
+		}
+
+		Base::onChildResize(child);
+	}
+
+	Item* findItem(const Base* child)
+	{
+		for (size_t i = 0, sz = m_items.size(); i < sz; ++i)
+		{
+			if (m_items[i].widget == child)
+				return &m_items[i];
+		}
+
+		return NULL;
+	}
+
+private:
+
+	T m_measuredWidth, m_measuredHeight;
+	bool m_measureDirty;
+	bool m_layoutDirty;
+	bool m_applying;
+
+	BasicLayout* getParentLayout()
+	{
+		return dynamic_cast<BasicLayout*>(this->getParent());
+	}
+
+	void markLayoutDirty()
+	{
+		m_layoutDirty = true;
+
+		// Make sure we get an update, even when sleeping.
+		this->requestUpdate();
+	}
+
+	// Children removed without a Disown event (see Widget::destroyChildren) leave stale items behind.
+	// Every child gets an item on adoption, so a count mismatch means the items have to be rebuilt from the children.
+	void syncItems()
+	{
+		if (m_items.size() == this->getNumOfChildren())
+			return;
+
+		m_items.clear();
+
+		for (size_t i = 0, sz = this->getNumOfChildren(); i < sz; ++i)
+		{
+			Base* child = this->getChild(i);
+
+			Item item;
+			item.widget = child;
+			item.layout = dynamic_cast<BasicLayout*>(child);
+			item.width = child->getWidth();
+			item.height = child->getHeight();
+			item.grow = 0.f;
+
+			m_items.push_back(item);
+		}
+	}
+
+};
+
+
+// Lays out children one after another, either from top to bottom or from left to right.
+// Children keep their preferred length along the stack, and are stretched across it.
+template <typename T>
+class BasicStackLayout : public BasicLayout<T>
+{
+public:
+
+	typedef BasicLayout<T> Layout;
+	typedef typename Layout::Item Item;
+
+	enum Direction
+	{
+		VERTICAL,
+		HORIZONTAL
+	};
+
+	explicit BasicStackLayout(Direction direction = VERTICAL)
+		: m_direction(direction)
+	{
+
+	}
+
+	void setDirection(Direction direction)
+	{
+		m_direction = direction;
+		this->invalidateLayout();
+	}
+
+	Direction getDirection() const
+	{
+		return m_direction;
+	}
+
+protected:
+
+	// Split an item size into its length along the stack and across it.
+	void split(T width, T height, T& out_main, T& out_cross) const
+	{
+		out_main = (m_direction == VERTICAL) ? height : width;
+		out_cross = (m_direction == VERTICAL) ? width : height;
+	}
+
+	virtual void measure(T& out_width, T& out_height)
+	{
+		T main = T(0), cross = T(0);
+
+		for (size_t i = 0, sz = this->m_items.size(); i < sz; ++i)
+		{
+			T w, h, itemMain, itemCross;
+			Layout::getItemSize(this->m_items[i], w, h);
+			this->split(w, h, itemMain, itemCross);
+
+			main += itemMain;
+			if (itemCross > cross)
+				cross = itemCross;
+		}
+
+		if (!this->m_items.empty())
+			main += this->m_spacing * T(this->m_items.size() - 1);
+
+		main += this->m_padding * T(2);
+		cross += this->m_padding * T(2);
+
+		out_width = (m_direction == VERTICAL) ? cross : main;
+		out_height = (m_direction == VERTICAL) ? main : cross;
+	}
+
+	virtual void arrange()
+	{
+		size_t count = this->m_items.size();
+
+		if (count == 0)
+			return;
+
+		T padding = this->m_padding;
+		T spacing = this->m_spacing;
+		T available, cross;
+		this->split(this->getWidth(), this->getHeight(), available, cross);
+
+		cross -= padding * T(2);
+		available -= padding * T(2) + spacing * T(count - 1);
+
+		// Share out what is left over by the preferred lengths, by grow factor.
+		T preferred = T(0);
+		float totalGrow = 0.f;
+
+		for (size_t i = 0; i < count; ++i)
+		{
+			T w, h, itemMain, itemCross;
+			Layout::getItemSize(this->m_items[i], w, h);
+			this->split(w, h, itemMain, itemCross);
+
+			preferred += itemMain;
+			totalGrow += this->m_items[i].grow;
+		}
+
+		T extra = available - preferred;
+		if (extra < T(0) || totalGrow <= 0.f)
+			extra = T(0);
+
+		T pos = padding;
+
+		for (size_t i = 0; i < count; ++i)
+		{
+			Item& item = this->m_items[i];
+
+			T w, h, length, itemCross;
+			Layout::getItemSize(item, w, h);
+			this->split(w, h, length, itemCross);
+
+			if (item.grow > 0.f)
+				length += static_cast<T>(extra * (item.grow / totalGrow));
+
+			if (m_direction == VERTICAL)
+				Layout::place(item, padding, pos, cross, length);
+			else
+				Layout::place(item, pos, padding, length, cross);
+
+			pos += length + spacing;
+		}
+	}
+
+private:
+
+	Direction m_direction;
+
+};
+
+
+// A stack layout whose children can grow to fill the space left over.
+// Left-over space is shared out by grow factor. Children with no grow factor keep their preferred length.
+template <typename T>
+class BasicFlexLayout : public BasicStackLayout<T>
+{
+public:
+
+	typedef BasicStackLayout<T> Stack;
+
+	explicit BasicFlexLayout(typename Stack::Direction direction = Stack::VERTICAL)
+		: Stack(direction)
+	{
+
+	}
+
+	// Set a child's share of the left-over space.
+	void setGrow(const BasicWidget<T>* child, float grow)
+	{
+		typename Stack::Item* item = this->findItem(child);
+
+		if (!item || item->grow == grow)
+			return;
+
+		item->grow = grow;
+
+		// Growing doesn't change the measured size.
+		this->invalidateLayout();
+	}
+
+	float getGrow(const BasicWidget<T>* child)
+	{
+		typename Stack::Item* item = this->findItem(child);
+
+		return item ? item->grow : 0.f;
+	}
+
+};
+
+
+// Lays out children in a grid of equally sized cells, filling rows from left to right.
+// Cells are as big as the biggest preferred size, and are stretched to fill the layout.
+template <typename T>
+class BasicGridLayout : public BasicLayout<T>
+{
+public:
+
+	typedef BasicLayout<T> Layout;
+
+	explicit BasicGridLayout(size_t columns = 1)
+		: m_columns(columns ? columns : 1)
+	{
+
+	}
+
+	void setColumns(size_t columns)
+	{
+		m_columns = columns ? columns : 1;
+		this->invalidateLayout();
+	}
+
+	size_t getColumns() const
+	{
+		return m_columns;
+	}
+
+	size_t getRows() const
+	{
+		return (this->m_items.size() + m_columns - 1) / m_columns;
+	}
+
+protected:
+
+	virtual void measure(T& out_width, T& out_height)
+	{
+		T cellWidth = T(0), cellHeight = T(0);
+
+		for (size_t i = 0, sz = this->m_items.size(); i < sz; ++i)
+		{
+			T w, h;
+			Layout::getItemSize(this->m_items[i], w, h);
+
+			if (w > cellWidth)
+				cellWidth = w;
+			if (h > cellHeight)
+				cellHeight = h;
+		}
+
+		size_t rows = this->getRows();
+		size_t columns = rows ? m_columns : 0;
+
+		out_width = cellWidth * T(columns) + this->m_padding * T(2);
+		out_height = cellHeight * T(rows) + this->m_padding * T(2);
+
+		if (columns > 1)
+			out_width += this->m_spacing * T(columns - 1);
+		if (rows > 1)
+			out_height += this->m_spacing * T(rows - 1);
+	}
+
+	virtual void arrange()
+	{
+		size_t rows = this->getRows();
+
+		if (rows == 0)
+			return;
+
+		T padding = this->m_padding;
+		T spacing = this->m_spacing;
+
+		T cellWidth = (this->getWidth() - padding * T(2) - spacing * T(m_columns - 1)) / T(m_columns);
+		T cellHeight = (this->getHeight() - padding * T(2) - spacing * T(rows - 1)) / T(rows);
+
+		for (size_t i = 0, sz = this->m_items.size(); i < sz; ++i)
+		{
+			T column = T(i % m_columns);
+			T row = T(i / m_columns);
+
+			Layout::place(this->m_items[i], padding + column * (cellWidth + spacing), padding + row * (cellHeight + spacing),
+				cellWidth, cellHeight);
+		}
+	}
+
+private:
+
+	size_t m_columns;
+
+};
+
+
+typedef BasicLayout<double> Layout;
+typedef BasicStackLayout<double> StackLayout;
+typedef BasicFlexLayout<double> FlexLayout;
+typedef BasicGridLayout<double> GridLayout;
+
+#endif
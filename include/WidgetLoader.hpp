@@ -0,0 +1,642 @@
+/* * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * *
+ *  WidgetLoader.hpp                                                                 *
+ *  Loading widget trees from memory-mapped binary files.                            *
+ *                                                                                   *
+ * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * *
+ *                                                                                   *
+ *      Copyright © 2013 Nathan Cousins                                              *
+ *                                                                                   *
+ *  Permission is hereby granted, free of charge, to any person obtaining a copy     *
+ *  of this software and associated documentation files (the “Software”), to deal    *
+ *  in the Software without restriction, including without limitation the rights     *
+ *  to use, copy, modify, merge, publish, distribute, sublicense, and/or sell        *
+ *  copies of the Software, and to permit persons to whom the Software is            *
+ *  furnished to do so, subject to the following conditions:                         *
+ *                                                                                   *
+ *  The above copyright notice and this permission notice shall be included in       *
+ *  all copies or substantial portions of the Software.                              *
+ *                                                                                   *
+ *  THE SOFTWARE IS PROVIDED “AS IS”, WITHOUT WARRANTY OF ANY KIND, EXPRESS          *
+ *  OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,      *
+ *  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE      *
+ *  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER           *
+ *  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,    *
+ *  OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN        *
+ *  THE SOFTWARE.                                                                    *
+ *                                                                                   *
+ * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * */
+
+
+#ifndef _WIDGETLOADER_HPP_INCLUDED
+#define _WIDGETLOADER_HPP_INCLUDED
+
+#include "Widget.hpp"
+
+#include <cstdio>
+#include <cstring>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#if defined(_WIN32)
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+
+// Layout of widget files. Everything is little-endian.
+//
+// Header (32 bytes):
+//   char[4] magic "WUIT", u32 version, u32 number of types, u32 number of nodes,
+//   u32 offset of the type table, u32 offset of the nodes, u32 offset of the data, u32 size of the data.
+// Type table: per type, u32 offset and u32 length of its name in the data.
+// Nodes (36 bytes each), parents before children:
+//   f32 x, f32 y, f32 width, f32 height, u32 type, u32 parent (NO_PARENT for top-level nodes), u32 flags,
+//   u32 offset and u32 size of the node's data, which is handed to the type's configure function.
+class WidgetFile
+{
+public:
+
+	static const unsigned int VERSION = 1;
+	static const unsigned int NO_PARENT = 0xffffffffu;
+
+	// Node flags.
+	static const unsigned int NODE_HIDDEN = 1 << 0;
+	static const unsigned int NODE_CLIP_CHILDREN = 1 << 1;
+
+	static const size_t HEADER_SIZE = 32;
+	static const size_t TYPE_SIZE = 8;
+	static const size_t NODE_SIZE = 36;
+
+	static const char* getMagic()
+	{
+		return "WUIT";
+	}
+
+	static unsigned int readU32(const unsigned char* p)
+	{
+		return static_cast<unsigned int>(p[0]) | (static_cast<unsigned int>(p[1]) << 8) |
+			(static_cast<unsigned int>(p[2]) << 16) | (static_cast<unsigned int>(p[3]) << 24);
+	}
+
+	static float readF32(const unsigned char* p)
+	{
+		unsigned int bits = readU32(p);
+		float v;
+		std::memcpy(&v, &bits, sizeof(v));
+		return v;
+	}
+
+	static void writeU32(std::vector<unsigned char>& out, unsigned int v)
+	{
+		for (int i = 0; i < 4; ++i)
+			out.push_back(static_cast<unsigned char>(v >> (i * 8)));
+	}
+
+	static void writeF32(std::vector<unsigned char>& out, float v)
+	{
+		unsigned int bits;
+		std::memcpy(&bits, &v, sizeof(bits));
+		writeU32(out, bits);
+	}
+};
+
+
+// Writes widget files, for tools and tests. Nodes must be added after their parent.
+class WidgetFileWriter
+{
+public:
+
+	/* *** Contruction/Deconstruction *** */
+
+	WidgetFileWriter()
+	{
+
+	}
+
+
+	/* *** Writing *** */
+
+	// Add a widget type by the name it is registered with. Returns its index, which is the same for the same name.
+	size_t addType(const char* name)
+	{
+		for (size_t i = 0, sz = m_types.size(); i < sz; ++i)
+		{
+			if (m_types[i] == name)
+				return i;
+		}
+
+		m_types.push_back(name);
+		return m_types.size() - 1;
+	}
+
+	// Add a node of a type from addType(). `parent' is the index of a node added before, or WidgetFile::NO_PARENT.
+	// `data' is copied into the file for the type's configure function. Returns the index of the node.
+	size_t addNode(size_t type, size_t parent, float x, float y, float width, float height,
+		unsigned int flags = 0, const void* data = NULL, size_t size = 0)
+	{
+		Node node;
+		node.x = x;
+		node.y = y;
+		node.width = width;
+		node.height = height;
+		node.type = static_cast<unsigned int>(type);
+		node.parent = (parent < m_nodes.size()) ? static_cast<unsigned int>(parent) : +WidgetFile::NO_PARENT;
+		node.flags = flags;
+		node.dataOffset = static_cast<unsigned int>(m_data.size());
+		node.dataSize = static_cast<unsigned int>(size);
+
+		if (size)
+			m_data.insert(m_data.end(), static_cast<const unsigned char*>(data), static_cast<const unsigned char*>(data) + size);
+
+		m_nodes.push_back(node);
+		return m_nodes.size() - 1;
+	}
+
+	// Get the number of nodes.
+	size_t getNumOfNodes() const
+	{
+		return m_nodes.size();
+	}
+
+	// Encode the file into `out'.
+	void write(std::vector<unsigned char>& out) const
+	{
+		size_t namesSize = 0;
+
+		for (size_t i = 0, sz = m_types.size(); i < sz; ++i)
+			namesSize += m_types[i].size();
+
+		unsigned int typesOffset = static_cast<unsigned int>(WidgetFile::HEADER_SIZE);
+		unsigned int nodesOffset = typesOffset + static_cast<unsigned int>(m_types.size() * WidgetFile::TYPE_SIZE);
+		unsigned int dataOffset = nodesOffset + static_cast<unsigned int>(m_nodes.size() * WidgetFile::NODE_SIZE);
+
+		out.clear();
+		out.reserve(dataOffset + namesSize + m_data.size());
+
+		out.insert(out.end(), WidgetFile::getMagic(), WidgetFile::getMagic() + 4);
+		WidgetFile::writeU32(out, WidgetFile::VERSION);
+		WidgetFile::writeU32(out, static_cast<unsigned int>(m_types.size()));
+		WidgetFile::writeU32(out, static_cast<unsigned int>(m_nodes.size()));
+		WidgetFile::writeU32(out, typesOffset);
+		WidgetFile::writeU32(out, nodesOffset);
+		WidgetFile::writeU32(out, dataOffset);
+		WidgetFile::writeU32(out, static_cast<unsigned int>(namesSize + m_data.size()));
+
+		// Node data comes first in the data, type names after it.
+		size_t name = m_data.size();
+
+		for (size_t i = 0, sz = m_types.size(); i < sz; ++i)
+		{
+			WidgetFile::writeU32(out, static_cast<unsigned int>(name));
+			WidgetFile::writeU32(out, static_cast<unsigned int>(m_types[i].size()));
+			name += m_types[i].size();
+		}
+
+		for (size_t i = 0, sz = m_nodes.size(); i < sz; ++i)
+		{
+			const Node& node = m_nodes[i];
+
+			WidgetFile::writeF32(out, node.x);
+			WidgetFile::writeF32(out, node.y);
+			WidgetFile::writeF32(out, node.width);
+			WidgetFile::writeF32(out, node.height);
+			WidgetFile::writeU32(out, node.type);
+			WidgetFile::writeU32(out, node.parent);
+			WidgetFile::writeU32(out, node.flags);
+			WidgetFile::writeU32(out, node.dataOffset);
+			WidgetFile::writeU32(out, node.dataSize);
+		}
+
+		out.insert(out.end(), m_data.begin(), m_data.end());
+
+		for (size_t i = 0, sz = m_types.size(); i < sz; ++i)
+			out.insert(out.end(), m_types[i].begin(), m_types[i].end());
+	}
+
+	// Write the file to disk. Returns false if it couldn't be written.
+	bool save(const char* path) const
+	{
+		std::vector<unsigned char> out;
+		this->write(out);
+
+		FILE* file = std::fopen(path, "wb");
+
+		if (!file)
+			return false;
+
+		bool ok = std::fwrite(&out[0], 1, out.size(), file) == out.size();
+
+		return std::fclose(file) == 0 && ok;
+	}
+
+private:
+
+	struct Node
+	{
+		float x, y, width, height;
+		unsigned int type;
+		unsigned int parent;
+		unsigned int flags;
+		unsigned int dataOffset;
+		unsigned int dataSize;
+	};
+
+	std::vector<std::string> m_types;
+	std::vector<Node> m_nodes;
+	std::vector<unsigned char> m_data;
+
+};
+
+
+// A read-only view of a whole file, mapped into memory.
+class MappedFile
+{
+public:
+
+	/* *** Contruction/Deconstruction *** */
+
+	MappedFile()
+		: m_data(NULL), m_size(0)
+	{
+#if defined(_WIN32)
+		m_file = INVALID_HANDLE_VALUE;
+		m_mapping = NULL;
+#endif
+	}
+
+	~MappedFile()
+	{
+		this->close();
+	}
+
+
+	/* *** Mapping *** */
+
+	// Map a file, unmapping the last one. Returns false if it couldn't be mapped. Empty files map to no data.
+	bool open(const char* path)
+	{
+		this->close();
+
+#if defined(_WIN32)
+		m_file = CreateFileA(path, GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+
+		if (m_file == INVALID_HANDLE_VALUE)
+			return false;
+
+		LARGE_INTEGER size;
+
+		if (!GetFileSizeEx(m_file, &size))
+		{
+			this->close();
+			return false;
+		}
+
+		m_size = static_cast<size_t>(size.QuadPart);
+
+		if (!m_size)
+			return true;
+
+		m_mapping = CreateFileMappingA(m_file, NULL, PAGE_READONLY, 0, 0, NULL);
+		m_data = m_mapping ? MapViewOfFile(m_mapping, FILE_MAP_READ, 0, 0, 0) : NULL;
+#else
+		int fd = ::open(path, O_RDONLY);
+
+		if (fd < 0)
+			return false;
+
+		struct stat st;
+
+		if (fstat(fd, &st) != 0)
+		{
+			::close(fd);
+			return false;
+		}
+
+		m_size = static_cast<size_t>(st.st_size);
+
+		if (m_size)
+		{
+			void* data = mmap(NULL, m_size, PROT_READ, MAP_PRIVATE, fd, 0);
+			m_data = (data != MAP_FAILED) ? data : NULL;
+		}
+
+		// The mapping stays valid without the descriptor.
+		::close(fd);
+#endif
+
+		if (m_size && !m_data)
+		{
+			this->close();
+			return false;
+		}
+
+		return true;
+	}
+
+	// Unmap the file.
+	void close()
+	{
+#if defined(_WIN32)
+		if (m_data)
+			UnmapViewOfFile(m_data);
+		if (m_mapping)
+			CloseHandle(m_mapping);
+		if (m_file != INVALID_HANDLE_VALUE)
+			CloseHandle(m_file);
+
+		m_file = INVALID_HANDLE_VALUE;
+		m_mapping = NULL;
+#else
+		if (m_data)
+			munmap(m_data, m_size);
+#endif
+
+		m_data = NULL;
+		m_size = 0;
+	}
+
+	const void* getData() const
+	{
+		return m_data;
+	}
+
+	size_t getSize() const
+	{
+		return m_size;
+	}
+
+private:
+
+	void* m_data;
+	size_t m_size;
+
+#if defined(_WIN32)
+	HANDLE m_file;
+	HANDLE m_mapping;
+#endif
+
+	// Mapped files are not copyable.
+	MappedFile(const MappedFile&);
+	MappedFile& operator=(const MappedFile&);
+
+};
+
+
+// Widget types that can be loaded, by name.
+template <typename T>
+class BasicWidgetRegistry
+{
+public:
+
+	typedef BasicWidget<T> Widget;
+
+	// Applies a node's data to a freshly constructed widget, before it has a parent.
+	// `data' points into the loaded file, and is only valid during the call.
+	typedef void (*Configure)(Widget& widget, const void* data, size_t size);
+
+	struct Type
+	{
+		typename Widget::BulkBuilder::Constructor construct;
+		size_t size;
+		Configure configure;
+	};
+
+
+	/* *** Types *** */
+
+	// Register a default-constructible widget type W under `name', replacing any type registered under the same name.
+	template <typename W>
+	void registerType(const char* name, Configure configure = NULL)
+	{
+		static_assert(alignof(W) <= WidgetPool::GRANULARITY, "Widget type is over-aligned for the widget pool.");
+
+		Type type;
+		type.construct = &Widget::BulkBuilder::template constructWidget<W>;
+		type.size = sizeof(W);
+		type.configure = configure;
+
+		m_types[name] = type;
+	}
+
+	// Find a type by name. Returns NULL if there is no such type.
+	const Type* find(const std::string& name) const
+	{
+		typename std::unordered_map<std::string, Type>::const_iterator it = m_types.find(name);
+
+		return (it != m_types.end()) ? &it->second : NULL;
+	}
+
+private:
+
+	std::unordered_map<std::string, Type> m_types;
+
+};
+
+
+// Loads widget files into a parent widget.
+// The file is checked completely before anything is constructed, so a bad file leaves the parent untouched.
+// Widgets are constructed in the tree's pool and attached with Widget::BulkBuilder: geometry and hierarchy are read straight
+// out of the file, and each top-level subtree is linked up without any events and attached to the parent as soon as it is
+// complete. (When the file doesn't store subtrees together, the whole tree is attached at the end.) onAdopt()/onAdopted()
+// are only sent once the whole tree is built. The geometry in the file is the widgets' initial geometry, so they get no
+// onMove() or onResize() for it. Loaded widgets are owned by the tree, like widgets made with create().
+template <typename T>
+class BasicWidgetLoader
+{
+public:
+
+	typedef BasicWidget<T> Widget;
+	typedef BasicWidgetRegistry<T> Registry;
+
+
+	/* *** Contruction/Deconstruction *** */
+
+	// The registry must outlive the loader.
+	BasicWidgetLoader(const Registry& registry)
+		: m_registry(registry), m_error(NULL)
+	{
+
+	}
+
+
+	/* *** Loading *** */
+
+	// Map a widget file and load it into `parent'. Returns false on failure, see getError().
+	bool loadFile(Widget& parent, const char* path)
+	{
+		MappedFile file;
+
+		if (!file.open(path))
+		{
+			m_widgets.clear();
+			return this->fail("Could not open the file.");
+		}
+
+		return this->load(parent, file.getData(), file.getSize());
+	}
+
+	// Load a widget file from memory into `parent'. The top-level nodes become children of `parent', in order.
+	// Returns false on failure, see getError().
+	bool load(Widget& parent, const void* data, size_t size)
+	{
+		const unsigned char* bytes = static_cast<const unsigned char*>(data);
+
+		m_widgets.clear();
+		m_error = NULL;
+
+		if (size < WidgetFile::HEADER_SIZE || std::memcmp(bytes, WidgetFile::getMagic(), 4) != 0)
+			return this->fail("Not a widget file.");
+
+		if (WidgetFile::readU32(bytes + 4) != WidgetFile::VERSION)
+			return this->fail("Unsupported widget file version.");
+
+		size_t numTypes = WidgetFile::readU32(bytes + 8);
+		size_t numNodes = WidgetFile::readU32(bytes + 12);
+		size_t typesOffset = WidgetFile::readU32(bytes + 16);
+		size_t nodesOffset = WidgetFile::readU32(bytes + 20);
+		size_t dataOffset = WidgetFile::readU32(bytes + 24);
+		size_t dataSize = WidgetFile::readU32(bytes + 28);
+
+		if (!inRange(typesOffset, numTypes * WidgetFile::TYPE_SIZE, size) ||
+			!inRange(nodesOffset, numNodes * WidgetFile::NODE_SIZE, size) || !inRange(dataOffset, dataSize, size))
+		{
+			return this->fail("Widget file is truncated.");
+		}
+
+		const unsigned char* types = bytes + typesOffset;
+		const unsigned char* nodes = bytes + nodesOffset;
+		const char* blob = reinterpret_cast<const char*>(bytes + dataOffset);
+
+		// Look up every type once.
+		m_types.resize(numTypes);
+
+		for (size_t i = 0; i < numTypes; ++i)
+		{
+			size_t nameOffset = WidgetFile::readU32(types + i * WidgetFile::TYPE_SIZE);
+			size_t nameLength = WidgetFile::readU32(types + i * WidgetFile::TYPE_SIZE + 4);
+
+			if (!inRange(nameOffset, nameLength, dataSize))
+				return this->fail("Widget file is malformed.");
+
+			if (!(m_types[i] = m_registry.find(std::string(blob + nameOffset, nameLength))))
+				return this->fail("Widget file uses an unregistered widget type.");
+		}
+
+		// Are the nodes of each top-level subtree stored together? Then each one can be attached as soon as it's built.
+		bool grouped = true;
+		size_t lastTop = 0;
+
+		for (size_t i = 0; i < numNodes; ++i)
+		{
+			const unsigned char* node = nodes + i * WidgetFile::NODE_SIZE;
+			size_t parentIdx = WidgetFile::readU32(node + 20);
+
+			if (WidgetFile::readU32(node + 16) >= numTypes ||
+				(parentIdx != WidgetFile::NO_PARENT && parentIdx >= i) ||
+				!inRange(WidgetFile::readU32(node + 28), WidgetFile::readU32(node + 32), dataSize))
+			{
+				return this->fail("Widget file is malformed.");
+			}
+
+			if (parentIdx == WidgetFile::NO_PARENT)
+				lastTop = i;
+			else if (parentIdx < lastTop)
+				grouped = false;
+		}
+
+		// Build the tree.
+		typename Widget::BulkBuilder builder(parent);
+		builder.reserve(numNodes);
+		m_widgets.reserve(numNodes);
+
+		for (size_t i = 0; i < numNodes; ++i)
+		{
+			const unsigned char* node = nodes + i * WidgetFile::NODE_SIZE;
+			const typename Registry::Type* type = m_types[WidgetFile::readU32(node + 16)];
+			size_t parentIdx = WidgetFile::readU32(node + 20);
+			unsigned int flags = WidgetFile::readU32(node + 24);
+
+			// The subtree before a new top-level node is complete: attach it while it's still in cache. Its events wait
+			// until the whole tree is built.
+			if (grouped && parentIdx == WidgetFile::NO_PARENT)
+				builder.attach();
+
+			size_t idx = builder.add(type->construct, type->size,
+				(parentIdx == WidgetFile::NO_PARENT) ? +Widget::BulkBuilder::NO_PARENT : parentIdx);
+
+			builder.setBounds(idx, T(WidgetFile::readF32(node)), T(WidgetFile::readF32(node + 4)),
+				T(WidgetFile::readF32(node + 8)), T(WidgetFile::readF32(node + 12)));
+
+			Widget* widget = builder.getWidget(idx);
+
+			if (flags & WidgetFile::NODE_HIDDEN)
+				widget->hide(true);
+
+			if (flags & WidgetFile::NODE_CLIP_CHILDREN)
+				widget->setClipChildren(true);
+
+			if (type->configure)
+				type->configure(*widget, blob + WidgetFile::readU32(node + 28), WidgetFile::readU32(node + 32));
+
+			m_widgets.push_back(widget);
+		}
+
+		builder.finish(false);
+
+		return true;
+	}
+
+	// Get why the last load failed. NULL if it didn't.
+	const char* getError() const
+	{
+		return m_error;
+	}
+
+	// Get the number of widgets made by the last load.
+	size_t getNumOfWidgets() const
+	{
+		return m_widgets.size();
+	}
+
+	// Get a widget made by the last load, by its node index in the file.
+	Widget* getWidget(size_t idx) const
+	{
+		return m_widgets[idx];
+	}
+
+private:
+
+	const Registry& m_registry;
+	const char* m_error;
+
+	std::vector<const typename Registry::Type*> m_types;
+	std::vector<Widget*> m_widgets;
+
+	bool fail(const char* error)
+	{
+		m_error = error;
+		return false;
+	}
+
+	// Does [offset, offset + length) fit in `size' bytes?
+	static bool inRange(unsigned long long offset, unsigned long long length, unsigned long long size)
+	{
+		return offset <= size && length <= size - offset;
+	}
+
+	// Loaders are not copyable.
+	BasicWidgetLoader(const BasicWidgetLoader&);
+	BasicWidgetLoader& operator=(const BasicWidgetLoader&);
+
+};
+
+
+typedef BasicWidgetRegistry<double> WidgetRegistry;
+typedef BasicWidgetLoader<double> WidgetLoader;
+
+#endif
@@ -0,0 +1,268 @@
+/* * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * *
+ *  WidgetPool.hpp                                                                   *
+ *  Size-class memory pool for widgets created by Widget::create().                  *
+ *                                                                                   *
+ * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * *
+ *                                                                                   *
+ *      Copyright © 2013 Nathan Cousins                                              *
+ *                                                                                   *
+ *  Permission is hereby granted, free of charge, to any person obtaining a copy     *
+ *  of this software and associated documentation files (the “Software”), to deal    *
+ *  in the Software without restriction, including without limitation the rights     *
+ *  to use, copy, modify, merge, publish, distribute, sublicense, and/or sell        *
+ *  copies of the Software, and to permit persons to whom the Software is            *
+ *  furnished to do so, subject to the following conditions:                         *
+ *                                                                                   *
+ *  The above copyright notice and this permission notice shall be included in       *
+ *  all copies or substantial portions of the Software.                              *
+ *                                                                                   *
+ *  THE SOFTWARE IS PROVIDED “AS IS”, WITHOUT WARRANTY OF ANY KIND, EXPRESS          *
+ *  OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,      *
+ *  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE      *
+ *  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER           *
+ *  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,    *
+ *  OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN        *
+ *  THE SOFTWARE.                                                                    *
+ *                                                                                   *
+ * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * */
+
+
+#ifndef _WIDGETPOOL_HPP_INCLUDED
+#define _WIDGETPOOL_HPP_INCLUDED
+
+#include <cstddef>
+#include <vector>
+
+
+// Memory for widgets, grouped into size classes.
+// Each size class carves its blocks out of its own chunks one after another, so widgets created together end up next to each other.
+// Freed blocks are kept on a per-class free list for reuse. Blocks bigger than MAX_BLOCK_SIZE come straight from operator new.
+// Pools are reference counted: the tree that made the pool holds one reference and every live block holds another,
+// so widgets can outlive their tree or be moved to another tree.
+// Widgets made together in large numbers can instead share one batch allocation, see allocateBatch().
+class WidgetPool
+{
+public:
+
+	static const size_t GRANULARITY = 16;
+	static const size_t MAX_BLOCK_SIZE = 1024;
+	static const size_t MAX_CHUNK_SIZE = 64 * 1024;
+
+	// Largest batch allocateBatch() can make.
+	static const size_t MAX_BATCH_SIZE = 1 << 30;
+
+
+	/* *** Contruction/Deconstruction *** */
+
+	WidgetPool()
+		: m_refs(1), m_spareBatch(NULL)
+	{
+		for (size_t i = 0; i < NUM_CLASSES; ++i)
+		{
+			m_free[i] = NULL;
+			m_next[i] = NULL;
+			m_end[i] = NULL;
+			m_chunkBlocks[i] = 0;
+		}
+	}
+
+
+	/* *** Reference counting *** */
+
+	void retain()
+	{
+		++m_refs;
+	}
+
+	// Drop a reference. The pool deletes itself once the last one is gone.
+	void release()
+	{
+		if (--m_refs == 0)
+			delete this;
+	}
+
+
+	/* *** Allocation *** */
+
+	// Allocate a block of at least `size' bytes, aligned to GRANULARITY. The block holds a reference to the pool.
+	void* allocate(size_t size)
+	{
+		++m_refs;
+
+		if (size == 0 || size > MAX_BLOCK_SIZE)
+			return ::operator new(size);
+
+		size_t c = sizeClass(size);
+
+		// Reuse a freed block if there is one.
+		if (m_free[c])
+		{
+			FreeBlock* block = m_free[c];
+			m_free[c] = block->next;
+			return block;
+		}
+
+		if (m_next[c] == m_end[c])
+			this->addChunk(c);
+
+		void* block = m_next[c];
+		m_next[c] += blockSize(c);
+
+		return block;
+	}
+
+	// Allocate a batch of `size' bytes holding `count' blocks, which must be laid out at multiples of GRANULARITY.
+	// Each block is given back with deallocate() like any other, using getBatchBlockSize() as its size, and holds a reference
+	// to the pool. The batch is freed in one go once all of its blocks are given back; until then none of its memory is reused.
+	// The last batch freed is kept for the next one that fits in it.
+	void* allocateBatch(size_t size, size_t count)
+	{
+		if (size > MAX_BATCH_SIZE || count == 0)
+			return NULL;
+
+		Batch* batch = m_spareBatch;
+
+		if (batch && batch->size >= size)
+		{
+			m_spareBatch = NULL;
+		}
+		else
+		{
+			batch = static_cast<Batch*>(::operator new(BATCH_HEADER_SIZE + size));
+			batch->size = size;
+		}
+
+		batch->blocks = count;
+
+		m_refs += count;
+
+		return reinterpret_cast<char*>(batch) + BATCH_HEADER_SIZE;
+	}
+
+	// Get the size to give a block of a batch back with. `offset' is where the block is in the batch.
+	static size_t getBatchBlockSize(size_t offset)
+	{
+		return BATCH_BLOCK | (BATCH_HEADER_SIZE + offset);
+	}
+
+	// Give a block back. `size' must be the size it was allocated with.
+	void deallocate(void* block, size_t size)
+	{
+		if (size & BATCH_BLOCK)
+		{
+			// The rest of the size is how far the block is from the start of its batch.
+			Batch* batch = reinterpret_cast<Batch*>(static_cast<char*>(block) - (size & ~BATCH_BLOCK));
+
+			if (--batch->blocks == 0)
+			{
+				if (m_spareBatch)
+					::operator delete(m_spareBatch);
+
+				m_spareBatch = batch;
+			}
+		}
+		else if (size == 0 || size > MAX_BLOCK_SIZE)
+		{
+			::operator delete(block);
+		}
+		else
+		{
+			size_t c = sizeClass(size);
+
+			FreeBlock* freed = static_cast<FreeBlock*>(block);
+			freed->next = m_free[c];
+			m_free[c] = freed;
+		}
+
+		this->release();
+	}
+
+	// Get the number of bytes reserved for pooled blocks.
+	size_t getReservedSize() const
+	{
+		size_t total = 0;
+
+		for (size_t i = 0, sz = m_chunkSizes.size(); i < sz; ++i)
+			total += m_chunkSizes[i];
+
+		return total;
+	}
+
+private:
+
+	static const size_t NUM_CLASSES = MAX_BLOCK_SIZE / GRANULARITY;
+
+	// Blocks in the first chunk of a size class. Later chunks double in size, up to MAX_CHUNK_SIZE.
+	static const size_t FIRST_CHUNK_BLOCKS = 16;
+
+	struct FreeBlock
+	{
+		FreeBlock* next;
+	};
+
+	// Header of a batch, followed by its blocks.
+	struct Batch
+	{
+		size_t size;              /* Bytes after the header. */
+		size_t blocks;            /* Blocks not given back yet. */
+	};
+
+	// Flag marking the size of a block from a batch. Sizes are kept in 32 bits by widgets.
+	static const size_t BATCH_BLOCK = 0x80000000u;
+	static const size_t BATCH_HEADER_SIZE = GRANULARITY;
+
+	size_t m_refs;
+
+	FreeBlock* m_free[NUM_CLASSES];
+	char* m_next[NUM_CLASSES];         /* Next unused block of the current chunk. */
+	char* m_end[NUM_CLASSES];          /* End of the current chunk. */
+	size_t m_chunkBlocks[NUM_CLASSES]; /* Blocks in the last chunk allocated for the class. */
+
+	std::vector<char*> m_chunks;
+	std::vector<size_t> m_chunkSizes;
+
+	Batch* m_spareBatch;               /* Last batch freed, kept for reuse. */
+
+	// Pools delete themselves, see release().
+	~WidgetPool()
+	{
+		::operator delete(m_spareBatch);
+
+		for (size_t i = 0, sz = m_chunks.size(); i < sz; ++i)
+			delete[] m_chunks[i];
+	}
+
+	static size_t sizeClass(size_t size)
+	{
+		return (size - 1) / GRANULARITY;
+	}
+
+	static size_t blockSize(size_t c)
+	{
+		return (c + 1) * GRANULARITY;
+	}
+
+	void addChunk(size_t c)
+	{
+		size_t blocks = m_chunkBlocks[c] ? m_chunkBlocks[c] * 2 : FIRST_CHUNK_BLOCKS;
+
+		if (blocks * blockSize(c) > MAX_CHUNK_SIZE)
+			blocks = MAX_CHUNK_SIZE / blockSize(c);
+
+		size_t chunkSize = blocks * blockSize(c);
+
+		m_chunks.push_back(new char[chunkSize]);
+		m_chunkSizes.push_back(chunkSize);
+
+		m_next[c] = m_chunks.back();
+		m_end[c] = m_next[c] + chunkSize;
+		m_chunkBlocks[c] = blocks;
+	}
+
+	// Pools are not copyable.
+	WidgetPool(const WidgetPool&);
+	WidgetPool& operator=(const WidgetPool&);
+
+};
+
+#endif
@@ -0,0 +1,298 @@
+/* * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * *
+ *  WidgetPrototype.hpp                                                              *
+ *  Stamping out copies of a recorded widget subtree.                                *
+ *                                                                                   *
+ * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * *
+ *                                                                                   *
+ *      Copyright © 2013 Nathan Cousins                                              *
+ *                                                                                   *
+ *  Permission is hereby granted, free of charge, to any person obtaining a copy     *
+ *  of this software and associated documentation files (the “Software”), to deal    *
+ *  in the Software without restriction, including without limitation the rights     *
+ *  to use, copy, modify, merge, publish, distribute, sublicense, and/or sell        *
+ *  copies of the Software, and to permit persons to whom the Software is            *
+ *  furnished to do so, subject to the following conditions:                         *
+ *                                                                                   *
+ *  The above copyright notice and this permission notice shall be included in       *
+ *  all copies or substantial portions of the Software.                              *
+ *                                                                                   *
+ *  THE SOFTWARE IS PROVIDED “AS IS”, WITHOUT WARRANTY OF ANY KIND, EXPRESS          *
+ *  OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,      *
+ *  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE      *
+ *  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER           *
+ *  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,    *
+ *  OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN        *
+ *  THE SOFTWARE.                                                                    *
+ *                                                                                   *
+ * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * */
+
+
+#ifndef _WIDGETPROTOTYPE_HPP_INCLUDED
+#define _WIDGETPROTOTYPE_HPP_INCLUDED
+
+#include "Widget.hpp"
+
+#include <algorithm>
+#include <vector>
+
+
+// A widget subtree recorded once, then instantiated many times, such as the cards of a dashboard.
+// Recording describes every widget of the subtree: its type, parent, bounds, flags and data for a configure function.
+// instantiate() makes any number of instances in one go. The widgets of many instances share a single allocation from the
+// tree's pool (see WidgetPool::allocateBatch()), laid out in recording order. Each instance is built with Widget::BulkBuilder:
+// its widgets are linked up without any events, an override function can change it, then it is attached to the parent and
+// gets the events that were held back. Instances are owned by the tree, like widgets made with create().
+template <typename T>
+class BasicWidgetPrototype
+{
+public:
+
+	typedef BasicWidget<T> Widget;
+	typedef typename Widget::BulkBuilder Builder;
+
+	static const size_t NO_PARENT = ~static_cast<size_t>(0);
+
+	// Applies a node's recorded data to a freshly constructed widget, before it is attached.
+	typedef void (*Configure)(Widget& widget, const void* data, size_t size);
+
+	// An instance being made, handed to the override function once all of its widgets are constructed and configured.
+	// Nothing is attached to the parent yet, and no events have been sent.
+	class Instance
+	{
+	public:
+
+		// Get which instance this is, counting from 0 for each call to instantiate().
+		size_t getIndex() const
+		{
+			return m_index;
+		}
+
+		// Get the widget made for a node of the prototype.
+		Widget* getWidget(size_t node) const
+		{
+			return m_builder.getWidget(m_first + node);
+		}
+
+		// Get the widget made for a node of the prototype, which was recorded with type W.
+		template <typename W>
+		W* get(size_t node) const
+		{
+			return static_cast<W*>(this->getWidget(node));
+		}
+
+		// Move a widget of the instance, without any events.
+		void setPosition(size_t node, T x, T y)
+		{
+			Widget* widget = this->getWidget(node);
+			m_builder.setBounds(m_first + node, x, y, widget->getWidth(), widget->getHeight());
+		}
+
+		// Set the bounds of a widget of the instance, without any events.
+		void setBounds(size_t node, T x, T y, T width, T height)
+		{
+			m_builder.setBounds(m_first + node, x, y, width, height);
+		}
+
+	private:
+
+		friend class BasicWidgetPrototype;
+
+		Builder& m_builder;
+		size_t m_first;           /* Builder index of the instance's first widget. */
+		size_t m_index;
+
+		Instance(Builder& builder, size_t first, size_t index)
+			: m_builder(builder), m_first(first), m_index(index)
+		{
+
+		}
+
+	};
+
+	// Changes an instance before it is attached. `udata' is the pointer given to instantiate().
+	typedef void (*Override)(Instance& instance, void* udata);
+
+
+	/* *** Contruction/Deconstruction *** */
+
+	BasicWidgetPrototype()
+		: m_instanceSize(0)
+	{
+
+	}
+
+
+	/* *** Recording *** */
+
+	// Record a widget made by `construct' in a block of `size' bytes. Its parent is the node `parent', which must have been
+	// recorded before it, or the parent given to instantiate() with NO_PARENT. `data' is copied into the prototype and handed to
+	// `configure' for every instance. Returns the index of the node.
+	size_t add(typename Builder::Constructor construct, size_t size, size_t parent = NO_PARENT,
+		Configure configure = NULL, const void* data = NULL, size_t dataSize = 0)
+	{
+		Node node;
+		node.construct = construct;
+		node.offset = m_instanceSize;
+		node.parent = (parent < m_nodes.size()) ? parent : +NO_PARENT;
+		node.x = node.y = node.width = node.height = T(0);
+		node.hidden = false;
+		node.clipChildren = false;
+		node.configure = configure;
+		node.dataOffset = m_data.size();
+		node.dataSize = dataSize;
+
+		if (dataSize)
+			m_data.insert(m_data.end(), static_cast<const unsigned char*>(data), static_cast<const unsigned char*>(data) + dataSize);
+
+		// Blocks are laid out one after another, each one aligned like blocks of the pool.
+		m_instanceSize += (size + WidgetPool::GRANULARITY - 1) & ~(WidgetPool::GRANULARITY - 1);
+
+		m_nodes.push_back(node);
+		return m_nodes.size() - 1;
+	}
+
+	// Record a widget of type W. Returns the index of the node.
+	template <typename W>
+	size_t add(size_t parent = NO_PARENT, Configure configure = NULL, const void* data = NULL, size_t dataSize = 0)
+	{
+		static_assert(alignof(W) <= WidgetPool::GRANULARITY, "Widget type is over-aligned for the widget pool.");
+
+		return this->add(&Builder::template constructWidget<W>, sizeof(W), parent, configure, data, dataSize);
+	}
+
+	// Set the bounds every instance starts with.
+	void setBounds(size_t node, T x, T y, T width, T height)
+	{
+		m_nodes[node].x = x;
+		m_nodes[node].y = y;
+		m_nodes[node].width = width;
+		m_nodes[node].height = height;
+	}
+
+	void setHidden(size_t node, bool hidden)
+	{
+		m_nodes[node].hidden = hidden;
+	}
+
+	void setClipChildren(size_t node, bool clip)
+	{
+		m_nodes[node].clipChildren = clip;
+	}
+
+	// Get the number of recorded widgets, which is the number of widgets in each instance.
+	size_t getNumOfNodes() const
+	{
+		return m_nodes.size();
+	}
+
+	// Get the number of bytes the widgets of an instance take.
+	size_t getInstanceSize() const
+	{
+		return m_instanceSize;
+	}
+
+	// Forget every recorded widget.
+	void clear()
+	{
+		m_nodes.clear();
+		m_data.clear();
+		m_instanceSize = 0;
+	}
+
+
+	/* *** Instancing *** */
+
+	// Make `count' instances in `parent'. Their top-level widgets become children of `parent', in order.
+	// `override' is called for each instance, before anything is attached. Returns false, without making anything, if an
+	// instance doesn't fit in a batch (WidgetPool::MAX_BATCH_SIZE).
+	bool instantiate(Widget& parent, size_t count, Override override = NULL, void* udata = NULL)
+	{
+		if (m_instanceSize > WidgetPool::MAX_BATCH_SIZE)
+			return false;
+
+		if (!count || m_nodes.empty())
+			return true;
+
+		Builder builder(parent);
+		builder.reserve(count * m_nodes.size());
+
+		WidgetPool* pool = builder.getPool();
+		size_t perBatch = WidgetPool::MAX_BATCH_SIZE / m_instanceSize;
+
+		char* batch = NULL;
+		size_t batchLeft = 0;
+		size_t base = 0;          /* Offset of the instance in the batch. */
+
+		for (size_t i = 0; i < count; ++i, --batchLeft, base += m_instanceSize)
+		{
+			if (!batchLeft)
+			{
+				batchLeft = std::min(perBatch, count - i);
+				batch = static_cast<char*>(pool->allocateBatch(batchLeft * m_instanceSize, batchLeft * m_nodes.size()));
+				base = 0;
+			}
+
+			size_t first = builder.getNumOfWidgets();
+
+			for (size_t n = 0, sz = m_nodes.size(); n < sz; ++n)
+			{
+				const Node& node = m_nodes[n];
+				size_t offset = base + node.offset;
+
+				size_t idx = builder.addInBlock(node.construct, batch + offset, WidgetPool::getBatchBlockSize(offset),
+					(node.parent == NO_PARENT) ? +Builder::NO_PARENT : first + node.parent);
+
+				builder.setBounds(idx, node.x, node.y, node.width, node.height);
+
+				Widget* widget = builder.getWidget(idx);
+
+				if (node.hidden)
+					widget->hide(true);
+
+				if (node.clipChildren)
+					widget->setClipChildren(true);
+
+				if (node.configure)
+					node.configure(*widget, node.dataSize ? &m_data[node.dataOffset] : NULL, node.dataSize);
+			}
+
+			if (override)
+			{
+				Instance instance(builder, first, i);
+				override(instance, udata);
+			}
+
+			// Attach the instance while it's still in cache. Holding back the events of every instance until the end would mean
+			// going over all of their memory a second time.
+			builder.finish();
+		}
+
+		return true;
+	}
+
+private:
+
+	// A recorded widget.
+	struct Node
+	{
+		typename Builder::Constructor construct;
+		size_t offset;            /* Where the widget is in an instance. */
+		size_t parent;
+		T x, y, width, height;
+		bool hidden;
+		bool clipChildren;
+		Configure configure;
+		size_t dataOffset;        /* Recorded data, in m_data. */
+		size_t dataSize;
+	};
+
+	std::vector<Node> m_nodes;
+	std::vector<unsigned char> m_data;
+	size_t m_instanceSize;
+
+};
+
+
+typedef BasicWidgetPrototype<double> WidgetPrototype;
+
+#endif
@@ -0,0 +1,233 @@
+/* * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * *
+ *  WidgetThreadPool.hpp                                                             *
+ *  Work-stealing thread pool for parallel widget updates.                           *
+ *                                                                                   *
+ * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * *
+ *                                                                                   *
+ *      Copyright © 2013 Nathan Cousins                                              *
+ *                                                                                   *
+ *  Permission is hereby granted, free of charge, to any person obtaining a copy     *
+ *  of this software and associated documentation files (the “Software”), to deal    *
+ *  in the Software without restriction, including without limitation the rights     *
+ *  to use, copy, modify, merge, publish, distribute, sublicense, and/or sell        *
+ *  copies of the Software, and to permit persons to whom the Software is            *
+ *  furnished to do so, subject to the following conditions:                         *
+ *                                                                                   *
+ *  The above copyright notice and this permission notice shall be included in       *
+ *  all copies or substantial portions of the Software.                              *
+ *                                                                                   *
+ *  THE SOFTWARE IS PROVIDED “AS IS”, WITHOUT WARRANTY OF ANY KIND, EXPRESS          *
+ *  OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,      *
+ *  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE      *
+ *  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER           *
+ *  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,    *
+ *  OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN        *
+ *  THE SOFTWARE.                                                                    *
+ *                                                                                   *
+ * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * */
+
+
+#ifndef _WIDGETTHREADPOOL_HPP_INCLUDED
+#define _WIDGETTHREADPOOL_HPP_INCLUDED
+
+#include "Widget.hpp"
+
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+
+// An UpdateExecutor running tasks on a fixed set of worker threads.
+// Each thread (including the one calling run()) has its own queue of tasks. Threads take tasks from the back of their
+// own queue, and steal from the front of the others' once it runs dry, so uneven subtrees still keep every thread busy.
+class WidgetThreadPool : public UpdateExecutor
+{
+public:
+
+	/* *** Contruction/Deconstruction *** */
+
+	// Start `threads' worker threads. With 0, one less than the number of hardware threads is used.
+	explicit WidgetThreadPool(unsigned int threads = 0)
+		: m_task(NULL), m_ctx(NULL), m_remaining(0), m_generation(0), m_quit(false)
+	{
+		if (threads == 0)
+		{
+			unsigned int hardware = std::thread::hardware_concurrency();
+			threads = (hardware > 1) ? hardware - 1 : 0;
+		}
+
+		// Queue 0 belongs to the thread calling run().
+		for (unsigned int i = 0; i <= threads; ++i)
+			m_queues.push_back(new Queue());
+
+		for (unsigned int i = 1; i <= threads; ++i)
+			m_threads.push_back(std::thread(&WidgetThreadPool::work, this, i));
+	}
+
+	virtual ~WidgetThreadPool()
+	{
+		{
+			std::lock_guard<std::mutex> lock(m_mutex);
+			m_quit = true;
+		}
+
+		m_wake.notify_all();
+
+		for (size_t i = 0, sz = m_threads.size(); i < sz; ++i)
+			m_threads[i].join();
+
+		for (size_t i = 0, sz = m_queues.size(); i < sz; ++i)
+			delete m_queues[i];
+	}
+
+
+	/* *** Running *** */
+
+	virtual void run(size_t count, void (*task)(void* ctx, size_t i), void* ctx)
+	{
+		if (count == 0)
+			return;
+
+		// Not worth waking anyone up for.
+		if (count == 1 || m_threads.empty())
+		{
+			for (size_t i = 0; i < count; ++i)
+				task(ctx, i);
+
+			return;
+		}
+
+		m_task = task;
+		m_ctx = ctx;
+		m_remaining = count;
+
+		// Deal the tasks out round-robin.
+		for (size_t i = 0; i < count; ++i)
+		{
+			Queue& queue = *m_queues[i % m_queues.size()];
+
+			std::lock_guard<std::mutex> lock(queue.mutex);
+			queue.tasks.push_back(i);
+		}
+
+		{
+			std::lock_guard<std::mutex> lock(m_mutex);
+			++m_generation;
+		}
+
+		m_wake.notify_all();
+
+		this->drain(0);
+
+		std::unique_lock<std::mutex> lock(m_mutex);
+		while (m_remaining != 0)
+			m_done.wait(lock);
+	}
+
+	// Get the number of worker threads, not counting the thread calling run().
+	size_t getNumOfThreads() const
+	{
+		return m_threads.size();
+	}
+
+private:
+
+	struct Queue
+	{
+		std::mutex mutex;
+		std::deque<size_t> tasks;
+	};
+
+	std::vector<std::thread> m_threads;
+	std::vector<Queue*> m_queues;
+
+	void (*m_task)(void* ctx, size_t i);
+	void* m_ctx;
+	std::atomic<size_t> m_remaining;
+
+	std::mutex m_mutex;
+	std::condition_variable m_wake;
+	std::condition_variable m_done;
+	unsigned long m_generation;
+	bool m_quit;
+
+	void work(size_t q)
+	{
+		unsigned long seen = 0;
+
+		for (;;)
+		{
+			{
+				std::unique_lock<std::mutex> lock(m_mutex);
+
+				while (!m_quit && m_generation == seen)
+					m_wake.wait(lock);
+
+				if (m_quit)
+					return;
+
+				seen = m_generation;
+			}
+
+			this->drain(q);
+		}
+	}
+
+	// Run tasks until there are none left to take or steal.
+	void drain(size_t q)
+	{
+		size_t i;
+
+		while (this->pop(q, i) || this->steal(q, i))
+		{
+			m_task(m_ctx, i);
+
+			if (--m_remaining == 0)
+			{
+				std::lock_guard<std::mutex> lock(m_mutex);
+				m_done.notify_all();
+			}
+		}
+	}
+
+	bool pop(size_t q, size_t& out_task)
+	{
+		Queue& queue = *m_queues[q];
+		std::lock_guard<std::mutex> lock(queue.mutex);
+
+		if (queue.tasks.empty())
+			return false;
+
+		out_task = queue.tasks.back();
+		queue.tasks.pop_back();
+		return true;
+	}
+
+	bool steal(size_t q, size_t& out_task)
+	{
+		for (size_t n = 1, sz = m_queues.size(); n < sz; ++n)
+		{
+			Queue& queue = *m_queues[(q + n) % sz];
+			std::lock_guard<std::mutex> lock(queue.mutex);
+
+			if (queue.tasks.empty())
+				continue;
+
+			out_task = queue.tasks.front();
+			queue.tasks.pop_front();
+			return true;
+		}
+
+		return false;
+	}
+
+	// Thread pools are not copyable.
+	WidgetThreadPool(const WidgetThreadPool&);
+	WidgetThreadPool& operator=(const WidgetThreadPool&);
+
+};
+
+#endif
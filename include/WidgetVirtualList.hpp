@@ -0,0 +1,506 @@
+/* * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * *
+ *  WidgetVirtualList.hpp                                                            *
+ *  Virtualized list and grid container for the Widget system.                       *
+ *                                                                                   *
+ * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * *
+ *                                                                                   *
+ *      Copyright © 2013 Nathan Cousins                                              *
+ *                                                                                   *
+ *  Permission is hereby granted, free of charge, to any person obtaining a copy     *
+ *  of this software and associated documentation files (the “Software”), to deal    *
+ *  in the Software without restriction, including without limitation the rights     *
+ *  to use, copy, modify, merge, publish, distribute, sublicense, and/or sell        *
+ *  copies of the Software, and to permit persons to whom the Software is            *
+ *  furnished to do so, subject to the following conditions:                         *
+ *                                                                                   *
+ *  The above copyright notice and this permission notice shall be included in       *
+ *  all copies or substantial portions of the Software.                              *
+ *                                                                                   *
+ *  THE SOFTWARE IS PROVIDED “AS IS”, WITHOUT WARRANTY OF ANY KIND, EXPRESS          *
+ *  OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,      *
+ *  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE      *
+ *  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER           *
+ *  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,    *
+ *  OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN        *
+ *  THE SOFTWARE.                                                                    *
+ *                                                                                   *
+ * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * */
+
+
+#ifndef _WIDGETVIRTUALLIST_HPP_INCLUDED
+#define _WIDGETVIRTUALLIST_HPP_INCLUDED
+
+#include "Widget.hpp"
+
+#include <cmath>
+#include <vector>
+
+
+// A scrolling list (or grid) of items, where only the visible items, plus some overscan, have widgets.
+// Item widgets are made by an adapter, and recycled as the list scrolls: a widget scrolled out of view is bound to
+// an item scrolling into view. Memory and the cost of events depend on the size of the viewport, not the number of items.
+// Items are laid out in rows of `columns' equally wide cells, from top to bottom.
+template <typename T>
+class BasicVirtualList : public BasicWidget<T>
+{
+public:
+
+	typedef BasicWidget<T> Base;
+
+	// Makes item widgets, and binds them to the data they show.
+	class Adapter
+	{
+	public:
+		virtual ~Adapter()
+		{
+
+		}
+
+		// Make a new item widget as a child of `list', usually with list.create<W>().
+		virtual Base* createItem(BasicVirtualList& list) = 0;
+
+		// Destroy an item widget made by createItem(). Widgets made with create() are destroyed by the list, others are
+		// deleted. Override this for widgets owned elsewhere.
+		virtual void destroyItem(Base& widget)
+		{
+			Base* parent = widget.getParent();
+
+			if (!parent || !parent->destroyWidget(&widget))
+				delete &widget;
+		}
+
+		// Show item `index' in `widget'.
+		virtual void bindItem(Base& widget, size_t index) = 0;
+
+		// `widget' no longer shows item `index'.
+		virtual void unbindItem(Base& widget, size_t index)
+		{
+
+		}
+	};
+
+
+	/* *** Contruction/Deconstruction *** */
+
+	BasicVirtualList()
+		: m_adapter(NULL), m_count(0), m_columns(1), m_itemHeight(T(16)), m_spacing(T(0)), m_overscan(2),
+		  m_scroll(T(0)), m_wheelStep(T(48)), m_first(0)
+	{
+		// Items scroll partly out of view.
+		this->setClipChildren(true);
+	}
+
+	virtual ~BasicVirtualList()
+	{
+		this->clearItems();
+	}
+
+
+	/* *** Data *** */
+
+	// Set the adapter making and binding item widgets. Widgets made by the previous adapter are destroyed.
+	// The adapter destroys its widgets when the list goes, so it must outlive the list or be unset first.
+	void setAdapter(Adapter* adapter)
+	{
+		if (m_adapter == adapter)
+			return;
+
+		this->clearItems();
+		m_adapter = adapter;
+		this->refresh();
+	}
+
+	Adapter* getAdapter() const
+	{
+		return m_adapter;
+	}
+
+	// Set the number of items. Visible items that are still in range stay bound.
+	void setItemCount(size_t count)
+	{
+		m_count = count;
+		this->refresh();
+	}
+
+	size_t getItemCount() const
+	{
+		return m_count;
+	}
+
+	// Bind item `index' again, if it is visible. Call this when its data changed.
+	void refreshItem(size_t index)
+	{
+		Base* widget = this->getItemWidget(index);
+
+		if (widget)
+		{
+			m_adapter->unbindItem(*widget, index);
+			m_adapter->bindItem(*widget, index);
+		}
+	}
+
+	// Bind every visible item again.
+	void refreshItems()
+	{
+		for (size_t i = 0, sz = m_active.size(); i < sz; ++i)
+		{
+			m_adapter->unbindItem(*m_active[i], m_first + i);
+			m_adapter->bindItem(*m_active[i], m_first + i);
+		}
+	}
+
+
+	/* *** Layout *** */
+
+	// Set the number of items per row. 1 makes a plain list.
+	void setColumns(size_t columns)
+	{
+		m_columns = columns ? columns : 1;
+		this->refresh();
+	}
+
+	size_t getColumns() const
+	{
+		return m_columns;
+	}
+
+	// Set the height of every item.
+	void setItemHeight(T height)
+	{
+		m_itemHeight = height;
+		this->refresh();
+	}
+
+	T getItemHeight() const
+	{
+		return m_itemHeight;
+	}
+
+	// Set the space between rows.
+	void setSpacing(T spacing)
+	{
+		m_spacing = spacing;
+		this->refresh();
+	}
+
+	T getSpacing() const
+	{
+		return m_spacing;
+	}
+
+	// Set the number of extra rows kept bound above and below the viewport.
+	void setOverscan(size_t rows)
+	{
+		m_overscan = rows;
+		this->refresh();
+	}
+
+	size_t getOverscan() const
+	{
+		return m_overscan;
+	}
+
+	size_t getNumOfRows() const
+	{
+		return (m_count + m_columns - 1) / m_columns;
+	}
+
+	// Get the height of all rows together.
+	T getContentHeight() const
+	{
+		size_t rows = this->getNumOfRows();
+
+		return rows ? T(rows) * (m_itemHeight + m_spacing) - m_spacing : T(0);
+	}
+
+
+	/* *** Scrolling *** */
+
+	// Scroll so that `offset' is at the top of the viewport. Clamped to the content.
+	void setScroll(T offset)
+	{
+		T maxScroll = this->getMaxScroll();
+
+		if (offset > maxScroll)
+			offset = maxScroll;
+		if (offset < T(0))
+			offset = T(0);
+
+		if (offset == m_scroll)
+			return;
+
+		m_scroll = offset;
+		this->refresh();
+	}
+
+	void scrollBy(T delta)
+	{
+		this->setScroll(m_scroll + delta);
+	}
+
+	// Scroll just enough to show item `index'.
+	void scrollToItem(size_t index)
+	{
+		T top = T(index / m_columns) * (m_itemHeight + m_spacing);
+
+		if (top < m_scroll)
+			this->setScroll(top);
+		else if (top + m_itemHeight > m_scroll + this->getHeight())
+			this->setScroll(top + m_itemHeight - this->getHeight());
+	}
+
+	T getScroll() const
+	{
+		return m_scroll;
+	}
+
+	T getMaxScroll() const
+	{
+		T maxScroll = this->getContentHeight() - this->getHeight();
+
+		return (maxScroll > T(0)) ? maxScroll : T(0);
+	}
+
+	// Set how far one step of the mouse wheel scrolls.
+	void setWheelStep(T step)
+	{
+		m_wheelStep = step;
+	}
+
+	T getWheelStep() const
+	{
+		return m_wheelStep;
+	}
+
+
+	/* *** Items *** */
+
+	// Get the widget showing item `index', or NULL if the item isn't bound.
+	Base* getItemWidget(size_t index)
+	{
+		if (index < m_first || index - m_first >= m_active.size())
+			return NULL;
+
+		return m_active[index - m_first];
+	}
+
+	// Get the item shown by `widget', or false if it doesn't show one.
+	bool getItemIndex(const Base* widget, size_t& out_index) const
+	{
+		for (size_t i = 0, sz = m_active.size(); i < sz; ++i)
+		{
+			if (m_active[i] == widget)
+			{
+				out_index = m_first + i;
+				return true;
+			}
+		}
+
+		return false;
+	}
+
+	// Get the range of bound items, [first, first + count).
+	void getBoundRange(size_t& out_first, size_t& out_count) const
+	{
+		out_first = m_first;
+		out_count = m_active.size();
+	}
+
+	// Get the number of item widgets made so far, bound or not.
+	size_t getNumOfItemWidgets() const
+	{
+		return m_active.size() + m_free.size();
+	}
+
+protected:
+
+	/* *** Widget events *** */
+
+	virtual void onResize()
+	{
+		// A shorter content may not scroll as far anymore.
+		if (m_scroll > this->getMaxScroll())
+			m_scroll = this->getMaxScroll();
+
+		this->refresh();
+
+		Base::onResize();
+	}
+
+	virtual void onMouseWheel(T x, T y, int d)
+	{
+		if (x >= T(0) && y >= T(0) && x < this->getWidth() && y < this->getHeight())
+			this->scrollBy(-m_wheelStep * T(d));
+
+		Base::onMouseWheel(x, y, d);
+	}
+
+	virtual void onDisown(Base& child)
+	{
+		// Forget item widgets removed by someone else.
+		for (size_t i = 0, sz = m_free.size(); i < sz; ++i)
+		{
+			if (m_free[i] == &child)
+			{
+				m_free.erase(m_free.begin() + i);
+				break;
+			}
+		}
+
+		for (size_t i = 0, sz = m_active.size(); i < sz; ++i)
+		{
+			if (m_active[i] == &child)
+			{
+				// Bind the item to another widget.
+				m_adapter->unbindItem(child, m_first + i);
+				m_active[i] = NULL;
+				this->refresh();
+				break;
+			}
+		}
+
+		Base::onDisown(child);
+	}
+
+private:
+
+	Adapter* m_adapter;
+	size_t m_count;
+	size_t m_columns;
+	T m_itemHeight;
+	T m_spacing;
+	size_t m_overscan;
+	T m_scroll;
+	T m_wheelStep;
+
+	size_t m_first;                 /* Item shown by m_active[0]. */
+	std::vector<Base*> m_active;    /* Bound widgets, by item. */
+	std::vector<Base*> m_free;      /* Unbound widgets, hidden, ready to be reused. */
+	std::vector<Base*> m_scratch;
+
+	// Bind the items in view, recycling the widgets of items that went out of view, and move everything into place.
+	void refresh()
+	{
+		if (!m_adapter)
+			return;
+
+		// Work out the rows in view, plus overscan.
+		T stride = m_itemHeight + m_spacing;
+		size_t rows = this->getNumOfRows();
+		size_t firstRow = 0, lastRow = 0;
+
+		if (rows && stride > T(0))
+		{
+			firstRow = static_cast<size_t>(m_scroll / stride);
+			lastRow = static_cast<size_t>(std::ceil((m_scroll + this->getHeight()) / stride));
+
+			firstRow = (firstRow > m_overscan) ? firstRow - m_overscan : 0;
+			lastRow += m_overscan;
+
+			if (lastRow > rows)
+				lastRow = rows;
+			if (firstRow > lastRow)
+				firstRow = lastRow;
+		}
+
+		size_t first = firstRow * m_columns;
+		size_t last = lastRow * m_columns;
+
+		if (last > m_count)
+			last = m_count;
+
+		// Release the widgets of items going out of range. Those staying in range keep their binding.
+		size_t oldLast = m_first + m_active.size();
+
+		for (size_t i = m_first; i < oldLast; ++i)
+		{
+			if ((i < first || i >= last) && m_active[i - m_first])
+			{
+				m_adapter->unbindItem(*m_active[i - m_first], i);
+				m_free.push_back(m_active[i - m_first]);
+			}
+		}
+
+		m_scratch.assign(last - first, static_cast<Base*>(NULL));
+
+		for (size_t i = (first > m_first) ? first : m_first; i < last && i < oldLast; ++i)
+			m_scratch[i - first] = m_active[i - m_first];
+
+		m_active.swap(m_scratch);
+		m_first = first;
+
+		// Bind the items coming into range, reusing released widgets first.
+		for (size_t i = 0, sz = m_active.size(); i < sz; ++i)
+		{
+			if (m_active[i])
+				continue;
+
+			Base* widget;
+
+			if (!m_free.empty())
+			{
+				widget = m_free.back();
+				m_free.pop_back();
+			}
+			else
+			{
+				widget = m_adapter->createItem(*this);
+
+				if (widget->getParent() != this)
+					this->addWidget(widget);
+			}
+
+			m_active[i] = widget;
+			m_adapter->bindItem(*widget, m_first + i);
+		}
+
+		// Widgets left over wait hidden.
+		for (size_t i = 0, sz = m_free.size(); i < sz; ++i)
+			m_free[i]->hide(true);
+
+		// Place the bound items. Events are only sent for what actually changed.
+		T cellWidth = this->getWidth() / T(m_columns);
+
+		for (size_t i = 0, sz = m_active.size(); i < sz; ++i)
+		{
+			Base* widget = m_active[i];
+			size_t index = m_first + i;
+
+			T x = T(index % m_columns) * cellWidth;
+			T y = T(index / m_columns) * stride - m_scroll;
+
+			if (widget->getPositionX() != x || widget->getPositionY() != y)
+				widget->setPosition(x, y);
+
+			if (widget->getWidth() != cellWidth || widget->getHeight() != m_itemHeight)
+				widget->setSize(cellWidth, m_itemHeight);
+
+			widget->hide(false);
+		}
+	}
+
+	// Destroy every item widget made by the adapter.
+	void clearItems()
+	{
+		if (!m_adapter)
+			return;
+
+		for (size_t i = 0, sz = m_active.size(); i < sz; ++i)
+			m_adapter->unbindItem(*m_active[i], m_first + i);
+
+		std::vector<Base*> widgets;
+		widgets.swap(m_active);
+		widgets.insert(widgets.end(), m_free.begin(), m_free.end());
+		m_free.clear();
+		m_first = 0;
+
+		for (size_t i = 0, sz = widgets.size(); i < sz; ++i)
+			m_adapter->destroyItem(*widgets[i]);
+	}
+
+};
+
+
+typedef BasicVirtualList<double> VirtualList;
+
+#endif
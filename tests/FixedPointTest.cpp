@@ -0,0 +1,131 @@
+/*********************************************************************
+ * Fixed-point coordinate test.                                      *
+ * Instantiates BasicWidget over a 16.16 fixed-point type that only  *
+ * converts to and from built-in types explicitly, then builds a     *
+ * small tree and hit-tests it through the child index and the       *
+ * screen index.                                                     *
+ *                                                                   *
+ * Build: g++ -O2 -std=c++11 -Iinclude tests/FixedPointTest.cpp      *
+ *        (or build and run the tests with CMake and ctest)          *
+ *********************************************************************/
+
+#include <Widget.hpp>
+
+#include <cstdio>
+#include <vector>
+
+
+// 16.16 fixed-point number.
+class Fixed
+{
+public:
+	Fixed()
+		: m_raw(0)
+	{
+
+	}
+
+	explicit Fixed(int v)
+		: m_raw(v * ONE)
+	{
+
+	}
+
+	explicit Fixed(double v)
+		: m_raw(static_cast<int>(v * ONE))
+	{
+
+	}
+
+	explicit operator double() const
+	{
+		return double(m_raw) / ONE;
+	}
+
+	Fixed operator+(Fixed o) const { return fromRaw(m_raw + o.m_raw); }
+	Fixed operator-(Fixed o) const { return fromRaw(m_raw - o.m_raw); }
+	Fixed operator-() const { return fromRaw(-m_raw); }
+	Fixed operator*(Fixed o) const { return fromRaw(static_cast<int>((static_cast<long long>(m_raw) * o.m_raw) / ONE)); }
+	Fixed operator/(Fixed o) const { return fromRaw(static_cast<int>((static_cast<long long>(m_raw) * ONE) / o.m_raw)); }
+
+	Fixed& operator+=(Fixed o) { m_raw += o.m_raw; return *this; }
+	Fixed& operator-=(Fixed o) { m_raw -= o.m_raw; return *this; }
+
+	bool operator==(Fixed o) const { return m_raw == o.m_raw; }
+	bool operator!=(Fixed o) const { return m_raw != o.m_raw; }
+	bool operator<(Fixed o) const { return m_raw < o.m_raw; }
+	bool operator>(Fixed o) const { return m_raw > o.m_raw; }
+	bool operator<=(Fixed o) const { return m_raw <= o.m_raw; }
+	bool operator>=(Fixed o) const { return m_raw >= o.m_raw; }
+
+private:
+	static const int ONE = 1 << 16;
+
+	int m_raw;
+
+	static Fixed fromRaw(int raw)
+	{
+		Fixed f;
+		f.m_raw = raw;
+		return f;
+	}
+};
+
+// Every member is compiled, not just the ones used below.
+template class BasicWidget<Fixed>;
+
+typedef BasicWidget<Fixed> FixedWidget;
+
+
+static int g_failures = 0;
+
+#define CHECK(cond, ...) \
+	do { if (!(cond)) { ++g_failures; std::printf(__VA_ARGS__); std::printf("\n"); } } while (0)
+
+
+int main()
+{
+	FixedWidget root;
+	root.setSize(Fixed(640), Fixed(480));
+	root.setDamageTracking(true);
+
+	FixedWidget* panel = root.create<FixedWidget>();
+	panel->setPosition(Fixed(10), Fixed(20));
+	panel->setSize(Fixed(600), Fixed(400));
+	panel->setSpatialIndex(true, Fixed(32));
+
+	std::vector<FixedWidget*> items;
+
+	for (int i = 0; i < 100; ++i)
+	{
+		FixedWidget* item = panel->create<FixedWidget>();
+		item->setPosition(Fixed((i % 10) * 50), Fixed((i / 10) * 30));
+		item->setSize(Fixed(40.5), Fixed(20));
+		items.push_back(item);
+	}
+
+	for (int i = 0; i < 100; ++i)
+	{
+		Fixed x = Fixed((i % 10) * 50 + 40), y = Fixed((i / 10) * 30 + 1);
+
+		CHECK(panel->getChildAt(x, y) == items[i], "item %d not found by the child index", i);
+
+		// Twice: the screen index is only built once the tree holds still between queries.
+		for (int k = 0; k < 2; ++k)
+			CHECK(root.widgetAt(x + Fixed(10), y + Fixed(20)) == items[i], "item %d not found on the screen", i);
+	}
+
+	items[5]->move(Fixed(0.25), Fixed(0));
+	CHECK(root.widgetAt(Fixed(5 * 50 + 40 + 10), Fixed(21)) == items[5], "moved item not found on the screen");
+
+	root.draw();
+
+	if (g_failures)
+	{
+		std::printf("%d failures\n", g_failures);
+		return 1;
+	}
+
+	std::printf("ok\n");
+	return 0;
+}
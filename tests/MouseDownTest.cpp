@@ -0,0 +1,169 @@
+/*********************************************************************
+ * Culled mouse-down test.                                           *
+ * Clicks all over a panel of overlapping children, with             *
+ * DISPATCH_CULLED_MOUSE_DOWN and without, and with the spatial      *
+ * index. When culled, each click must press the widget widgetAt()   *
+ * finds, and only the paths to it and widgets watching presses may  *
+ * get the mouse down.                                               *
+ *                                                                   *
+ * Build: g++ -O2 -std=c++11 -Iinclude tests/MouseDownTest.cpp       *
+ *        (or build and run the tests with CMake and ctest)          *
+ *********************************************************************/
+
+#include <Widget.hpp>
+
+#include <cstdio>
+#include <cstdlib>
+#include <map>
+#include <vector>
+
+
+static const int NUM_CHILDREN = 500;
+static const int NUM_CLICKS = 2000;
+static const double SIZE = 400.;
+
+static int g_failures = 0;
+
+#define CHECK(cond, ...) \
+	do { if (!(cond)) { ++g_failures; std::printf(__VA_ARGS__); std::printf("\n"); } } while (0)
+
+
+// Counts the mouse downs and presses it gets.
+class Counter : public Widget
+{
+public:
+	Counter()
+		: downs(0), presses(0)
+	{
+
+	}
+
+	int downs;
+	int presses;
+
+protected:
+	virtual void onMouseDown(double x, double y, unsigned int b)
+	{
+		++downs;
+		Widget::onMouseDown(x, y, b);
+	}
+
+	virtual void onPress(double x, double y, unsigned int b)
+	{
+		++presses;
+		Widget::onPress(x, y, b);
+	}
+};
+
+
+struct Tree
+{
+	Widget root;
+	Widget* panel;
+	std::vector<Counter*> children;
+	std::vector<Counter*> grandchildren;
+};
+
+// The same tree every time, for the same seed.
+static void build(Tree& tree, unsigned int flags, bool spatialIndex)
+{
+	std::srand(1);
+
+	tree.root.setSize(SIZE, SIZE);
+	tree.panel = tree.root.create<Widget>();
+	tree.panel->setSize(SIZE, SIZE);
+
+	if (spatialIndex)
+		tree.panel->setSpatialIndex(true, 20.);
+
+	for (int i = 0; i < NUM_CHILDREN; ++i)
+	{
+		Counter* child = tree.panel->create<Counter>();
+		child->setPosition(std::rand() % 380, std::rand() % 380);
+		child->setSize(5 + std::rand() % 30, 5 + std::rand() % 30);
+
+		if (i % 7 == 0)
+			child->hide();
+
+		// A popup-like grandchild, which wants to know about every click.
+		Counter* grandchild = child->create<Counter>();
+		grandchild->setSize(4., 4.);
+
+		if (i % 50 == 0)
+			grandchild->setPressWatching(true);
+
+		tree.children.push_back(child);
+		tree.grandchildren.push_back(grandchild);
+	}
+
+	tree.root.setDispatchFlags(flags);
+}
+
+// Count the widgets hit by each click in `out_hits', unless it's NULL.
+static void click(Tree& tree, std::map<Widget*, int>* out_hits)
+{
+	std::srand(2);
+
+	for (int i = 0; i < NUM_CLICKS; ++i)
+	{
+		double x = std::rand() % 4000 / 10., y = std::rand() % 4000 / 10.;
+
+		if (out_hits)
+			++(*out_hits)[tree.root.widgetAt(x, y)];
+
+		tree.root.mouseDown(x, y, 1);
+		tree.root.mouseUp(x, y, 1);
+	}
+}
+
+
+int main()
+{
+	for (int spatialIndex = 0; spatialIndex < 2; ++spatialIndex)
+	{
+		Tree broadcast, culled;
+		build(broadcast, Widget::DISPATCH_BROADCAST, spatialIndex != 0);
+		build(culled, Widget::DISPATCH_CULLED_MOUSE_DOWN, spatialIndex != 0);
+
+		std::map<Widget*, int> hits;
+		click(broadcast, NULL);
+		click(culled, &hits);
+
+		int culledDowns = 0, broadcastDowns = 0;
+
+		for (int i = 0; i < NUM_CHILDREN; ++i)
+		{
+			Counter* a = broadcast.children[i];
+			Counter* b = culled.children[i];
+			Counter* grandchild = culled.grandchildren[i];
+
+			// A broadcast also presses the children of widgets covered by a sibling, so only the children are compared.
+			CHECK(a->presses == b->presses, "child %d pressed %d times, %d when culled", i, a->presses, b->presses);
+			CHECK(b->presses == hits[b], "child %d pressed %d times, hit %d times", i, b->presses, hits[b]);
+			CHECK(grandchild->presses == hits[grandchild], "grandchild %d pressed %d times, hit %d times", i,
+				grandchild->presses, hits[grandchild]);
+
+			// Watchers get every mouse down, unless they are hidden.
+			if (grandchild->isPressWatching() && !b->isHidden())
+			{
+				CHECK(grandchild->downs == NUM_CLICKS, "watcher %d got %d mouse downs, expected %d", i, grandchild->downs,
+					NUM_CLICKS);
+			}
+
+			broadcastDowns += a->downs;
+			culledDowns += b->downs;
+		}
+
+		CHECK(broadcastDowns == NUM_CLICKS * NUM_CHILDREN, "broadcast sent %d mouse downs", broadcastDowns);
+		CHECK(culledDowns < broadcastDowns / 10, "culled dispatch sent %d mouse downs", culledDowns);
+	}
+
+	if (g_failures)
+	{
+		std::printf("%d failures\n", g_failures);
+		return 1;
+	}
+
+	std::printf("ok\n");
+	return 0;
+}
@@ -0,0 +1,155 @@
+/*********************************************************************
+ * Parallel update test.                                             *
+ * Sibling subtrees marked with setParallelUpdate() move and resize  *
+ * themselves (and their children) from onUpdate() on a thread pool, *
+ * then hit-tests in the shared parent must find them where they     *
+ * are, with packed bounds and with the spatial index.               *
+ *                                                                   *
+ * Build: g++ -O2 -std=c++11 -pthread -Iinclude                      *
+ *        tests/ParallelUpdateTest.cpp                               *
+ *        (or build and run the tests with CMake and ctest)          *
+ *********************************************************************/
+
+#include <Widget.hpp>
+#include <WidgetThreadPool.hpp>
+
+#include <cstdio>
+#include <vector>
+
+
+static const int GRID = 16;
+static const int NUM_FRAMES = 200;
+static const double CELL = 40.;
+
+static int g_failures = 0;
+
+#define CHECK(cond, ...) \
+	do { if (!(cond)) { ++g_failures; std::printf(__VA_ARGS__); std::printf("\n"); } } while (0)
+
+
+// Moves and resizes itself and its child every update, within its own grid cell.
+class Mover : public Widget
+{
+public:
+	Mover(int cell)
+		: m_cell(cell), m_frame(0), m_child(NULL)
+	{
+		this->setParallelUpdate(true);
+	}
+
+	void setChild(Widget* child)
+	{
+		m_child = child;
+	}
+
+	double getExpectedX(int frame) const
+	{
+		return (m_cell % GRID) * CELL + (frame % 10);
+	}
+
+	double getExpectedY(int frame) const
+	{
+		return (m_cell / GRID) * CELL + (frame % 7);
+	}
+
+protected:
+	virtual void onUpdate(double dt)
+	{
+		++m_frame;
+
+		this->setPosition(this->getExpectedX(m_frame), this->getExpectedY(m_frame));
+		this->setSize(20. + (m_frame % 5), 20.);
+
+		if (m_child)
+			m_child->setPosition(double(m_frame % 3), 0.);
+
+		Widget::onUpdate(dt);
+	}
+
+private:
+	int m_cell;
+	int m_frame;
+	Widget* m_child;
+};
+
+
+// Build a panel of GRID x GRID movers into `root'.
+static Widget* buildPanel(Widget& root, bool spatialIndex, std::vector<Mover*>& movers)
+{
+	Widget* panel = root.create<Widget>();
+	panel->setSize(GRID * CELL, GRID * CELL);
+
+	if (spatialIndex)
+		panel->setSpatialIndex(true, CELL);
+	else
+		panel->setPackedBounds(true);
+
+	for (int i = 0; i < GRID * GRID; ++i)
+	{
+		Mover* mover = panel->create<Mover>(i);
+		mover->setPosition((i % GRID) * CELL, (i / GRID) * CELL);
+		mover->setSize(20., 20.);
+
+		Widget* child = mover->create<Widget>();
+		child->setSize(5., 5.);
+		mover->setChild(child);
+
+		movers.push_back(mover);
+	}
+
+	return panel;
+}
+
+static void run(bool spatialIndex, UpdateExecutor* executor)
+{
+	Widget root;
+	root.setSize(GRID * CELL, GRID * CELL);
+	root.setDamageTracking(true);
+	root.setUpdateExecutor(executor);
+
+	std::vector<Mover*> movers;
+	Widget* panel = buildPanel(root, spatialIndex, movers);
+
+	for (int frame = 1; frame <= NUM_FRAMES; ++frame)
+	{
+		root.update(1. / 60.);
+
+		for (size_t i = 0, sz = movers.size(); i < sz; ++i)
+		{
+			Mover* mover = movers[i];
+			double x = mover->getExpectedX(frame), y = mover->getExpectedY(frame);
+
+			CHECK(mover->getPositionX() == x && mover->getPositionY() == y,
+				"frame %d: mover %d is at [%g, %g], expected [%g, %g]", frame, int(i),
+				mover->getPositionX(), mover->getPositionY(), x, y);
+
+			// The far corner only lies inside the mover at its new size.
+			double far = 20. + (frame % 5) - 0.5;
+
+			CHECK(panel->getChildAt(x + far, y + 0.5) == mover,
+				"frame %d: mover %d not found at its new bounds (%s)", frame, int(i), spatialIndex ? "index" : "packed");
+		}
+
+		root.draw();
+	}
+}
+
+
+int main()
+{
+	WidgetThreadPool pool(4);
+
+	run(false, NULL);
+	run(true, NULL);
+	run(false, &pool);
+	run(true, &pool);
+
+	if (g_failures)
+	{
+		std::printf("%d failures\n", g_failures);
+		return 1;
+	}
+
+	std::printf("ok\n");
+	return 0;
+}